@@ -0,0 +1,21 @@
+-- pgauditlogtofile microbenchmark
+--   make bench [BENCH_RECORDS=n]
+\set records `echo ${BENCH_RECORDS:-10000}`
+
+CREATE FUNCTION pg_temp.pgauditlogtofile_bench(num_records bigint,
+    OUT name text,
+    OUT statement_bytes integer,
+    OUT records bigint,
+    OUT ns_per_record float8,
+    OUT bytes_per_record bigint,
+    OUT bytes_per_s float8)
+RETURNS SETOF record
+AS '$libdir/pgauditlogtofile_bench', 'pgauditlogtofile_bench'
+LANGUAGE C STRICT VOLATILE;
+
+SELECT name, statement_bytes, records,
+       round(ns_per_record::numeric, 1) AS ns_per_record,
+       bytes_per_record,
+       round((bytes_per_s / 1048576)::numeric, 1) AS mib_per_s
+  FROM pg_temp.pgauditlogtofile_bench(:records)
+ ORDER BY statement_bytes, name;
@@ -0,0 +1,341 @@
+/*-------------------------------------------------------------------------
+ *
+ * pgauditlogtofile_bench.c
+ *      Microbenchmark of the audit record hot paths
+ *
+ * The harness is a separate module linked with its own copy of the
+ * extension objects, so it has private globals: it runs the formatters,
+ * the compressors and the emit_log filter in the calling backend without
+ * touching the files or the shared memory of a running pgauditlogtofile.
+ *
+ * Copyright (c) 2026, Francisco Miguel Biete Banon
+ *
+ * This code is released under the PostgreSQL licence, as given at
+ *  http://www.postgresql.org/about/licence/
+ *-------------------------------------------------------------------------
+ */
+#include <postgres.h>
+
+#include "logtofile_csv.h"
+#include "logtofile_json.h"
+#include "logtofile_log.h"
+#include "logtofile_shmem.h"
+#include "logtofile_vars.h"
+
+#include <fmgr.h>
+#include <funcapi.h>
+#include <lib/stringinfo.h>
+#include <miscadmin.h>
+#include <port/atomics.h>
+#include <portability/instr_time.h>
+#include <utils/builtins.h>
+#include <utils/memutils.h>
+#include <utils/tuplestore.h>
+
+#ifdef PG_MODULE_MAGIC_EXT // Added in 18
+PG_MODULE_MAGIC_EXT(.name = "pgauditlogtofile_bench", .version = "1.9");
+#else
+PG_MODULE_MAGIC; // For PostgreSQL versions < 18
+#endif
+
+/* Defines */
+#define PGAUDIT_LTF_BENCH_COLS 6
+#define PGAUDIT_LTF_BENCH_PREFIX_LENGTH 7 // "AUDIT: "
+#define PGAUDIT_LTF_BENCH_RECORD_SIZE_INIT (4 * 1024)
+
+typedef enum
+{
+  PGAUDIT_LTF_BENCH_CSV,
+  PGAUDIT_LTF_BENCH_CSV_PLAIN,
+  PGAUDIT_LTF_BENCH_JSON,
+  PGAUDIT_LTF_BENCH_JSON_PLAIN,
+  PGAUDIT_LTF_BENCH_GZIP,
+  PGAUDIT_LTF_BENCH_LZ4,
+  PGAUDIT_LTF_BENCH_ZSTD,
+  PGAUDIT_LTF_BENCH_REJECT,
+  PGAUDIT_LTF_BENCH_COUNT
+} PgAuditLogToFileBenchCase;
+
+/*
+ * csv and json split the pgaudit message into columns, the _plain variants
+ * keep it as a single message: the difference is the cost of the splitter.
+ */
+static const char *const pgaudit_ltf_bench_names[PGAUDIT_LTF_BENCH_COUNT] = {
+    "csv", "csv_plain", "json", "json_plain", "gzip", "lz4", "zstd", "emit_log_reject"};
+
+/* statement sizes of the synthetic corpora */
+static const int pgaudit_ltf_bench_sizes[] = {64, 1024, 16 * 1024, 256 * 1024};
+
+/* forward declaration private functions */
+static void pgauditlogtofile_bench_setup(void);
+static char *pgauditlogtofile_bench_statement(int size);
+static ErrorData *pgauditlogtofile_bench_edata(const char *message);
+static void pgauditlogtofile_bench_run(PgAuditLogToFileBenchCase bench_case, const ErrorData *edata,
+                                       const StringInfo record, int64 records, uint64 *bytes, instr_time *elapsed);
+
+PG_FUNCTION_INFO_V1(pgauditlogtofile_bench);
+
+/**
+ * @brief SQL function - runs every case against every corpus
+ * @param records: records per case and corpus
+ * @return Datum - set of (name, statement_bytes, records, ns_per_record, bytes_per_record, bytes_per_s)
+ */
+Datum pgauditlogtofile_bench(PG_FUNCTION_ARGS)
+{
+  ReturnSetInfo *rsinfo = (ReturnSetInfo *)fcinfo->resultinfo;
+  int64 records = PG_GETARG_INT64(0);
+  TupleDesc tupdesc;
+  Tuplestorestate *tupstore;
+  MemoryContext oldcontext;
+  MemoryContext bench_context;
+  int i;
+  int bench_case;
+
+  if (rsinfo == NULL || !IsA(rsinfo, ReturnSetInfo))
+    ereport(ERROR,
+            (errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+             errmsg("set-valued function called in context that cannot accept a set")));
+  if (!(rsinfo->allowedModes & SFRM_Materialize))
+    ereport(ERROR,
+            (errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+             errmsg("materialize mode required, but it is not allowed in this context")));
+  if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+    elog(ERROR, "return type must be a row type");
+  if (records <= 0)
+    ereport(ERROR,
+            (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+             errmsg("records must be greater than zero")));
+
+  oldcontext = MemoryContextSwitchTo(rsinfo->econtext->ecxt_per_query_memory);
+  tupstore = tuplestore_begin_heap(true, false, work_mem);
+  rsinfo->returnMode = SFRM_Materialize;
+  rsinfo->setResult = tupstore;
+  rsinfo->setDesc = tupdesc;
+  MemoryContextSwitchTo(oldcontext);
+
+  pgauditlogtofile_bench_setup();
+
+  bench_context = AllocSetContextCreate(CurrentMemoryContext, "pgauditlogtofile bench context",
+                                        ALLOCSET_DEFAULT_SIZES);
+  oldcontext = MemoryContextSwitchTo(bench_context);
+
+  for (i = 0; i < lengthof(pgaudit_ltf_bench_sizes); i++)
+  {
+    char *statement = pgauditlogtofile_bench_statement(pgaudit_ltf_bench_sizes[i]);
+    ErrorData *audit_edata;
+    ErrorData *server_edata;
+    StringInfoData record;
+
+    /* pgaudit quotes the statement because it has commas and quotes */
+    audit_edata = pgauditlogtofile_bench_edata(
+        psprintf("AUDIT: SESSION,1,1,READ,SELECT,TABLE,public.bench,%s,<not logged>", statement));
+    server_edata = pgauditlogtofile_bench_edata(
+        psprintf("duration: 0.042 ms  statement: %s", statement));
+
+    /* the compressors take the csv record as input, same as the write path */
+    initStringInfo(&record);
+    PgAuditLogToFile_csv_audit(&record, audit_edata, PGAUDIT_LTF_BENCH_PREFIX_LENGTH, NULL, 1);
+
+    for (bench_case = 0; bench_case < PGAUDIT_LTF_BENCH_COUNT; bench_case++)
+    {
+      Datum values[PGAUDIT_LTF_BENCH_COLS];
+      bool nulls[PGAUDIT_LTF_BENCH_COLS] = {0};
+      uint64 bytes = 0;
+      instr_time elapsed;
+      double ns;
+
+      CHECK_FOR_INTERRUPTS();
+
+      pgauditlogtofile_bench_run((PgAuditLogToFileBenchCase)bench_case,
+                                 bench_case == PGAUDIT_LTF_BENCH_REJECT ? server_edata : audit_edata,
+                                 &record, records, &bytes, &elapsed);
+      ns = (double)INSTR_TIME_GET_MICROSEC(elapsed) * 1000.0;
+
+      values[0] = CStringGetTextDatum(pgaudit_ltf_bench_names[bench_case]);
+      values[1] = Int32GetDatum(pgaudit_ltf_bench_sizes[i]);
+      values[2] = Int64GetDatum(records);
+      values[3] = Float8GetDatum(ns / records);
+      values[4] = Int64GetDatum((int64)(bytes / records));
+      if (ns > 0)
+        values[5] = Float8GetDatum((double)bytes * 1000000000.0 / ns);
+      else
+        nulls[5] = true;
+
+      tuplestore_putvalues(tupstore, tupdesc, values, nulls);
+    }
+
+    MemoryContextReset(bench_context);
+  }
+
+  MemoryContextSwitchTo(oldcontext);
+  MemoryContextDelete(bench_context);
+
+  return (Datum)0;
+}
+
+/* private functions */
+
+/**
+ * @brief Prepares the private copy of the extension state, once per backend
+ * @param void
+ * @return void
+ */
+static void
+pgauditlogtofile_bench_setup(void)
+{
+  MemoryContext oldcontext;
+
+  if (pgaudit_ltf_memory_context != NULL)
+    return;
+
+  pgaudit_ltf_memory_context = AllocSetContextCreate(TopMemoryContext, "pgauditlogtofile bench",
+                                                     ALLOCSET_DEFAULT_SIZES);
+
+  oldcontext = MemoryContextSwitchTo(pgaudit_ltf_memory_context);
+  pgaudit_ltf_shm = PgAuditLogToFile_shmem_local();
+  MemoryContextSwitchTo(oldcontext);
+
+  /* enough for pgauditlogtofile_is_enabled, nothing is ever opened */
+  pg_atomic_init_flag(&pgaudit_ltf_flag_shutdown);
+  guc_pgaudit_ltf_log_directory = "log";
+  guc_pgaudit_ltf_log_filename = "audit-%Y%m%d_%H%M.log";
+  guc_pgaudit_ltf_log_connections = true;
+  guc_pgaudit_ltf_log_disconnections = true;
+}
+
+/**
+ * @brief Builds a pgaudit quoted SELECT statement of the given size
+ * @param size: statement size in bytes, before quoting
+ * @return char * - quoted statement
+ */
+static char *
+pgauditlogtofile_bench_statement(int size)
+{
+  static const char *const chunk = "SELECT \"Col\", 'a,b', x + 1 FROM t WHERE y = 'it''s'; ";
+  StringInfoData raw;
+  StringInfoData quoted;
+  const char *p;
+
+  initStringInfo(&raw);
+  while (raw.len < size)
+    appendStringInfoString(&raw, chunk);
+  raw.data[size] = '\0';
+  raw.len = size;
+
+  initStringInfo(&quoted);
+  appendStringInfoCharMacro(&quoted, '"');
+  for (p = raw.data; *p; p++)
+  {
+    if (*p == '"')
+      appendStringInfoCharMacro(&quoted, '"');
+    appendStringInfoCharMacro(&quoted, *p);
+  }
+  appendStringInfoCharMacro(&quoted, '"');
+
+  pfree(raw.data);
+  return quoted.data;
+}
+
+/**
+ * @brief Builds the ErrorData of a LOG message, as pgaudit emits it
+ * @param message: message of the record
+ * @return ErrorData * - record
+ */
+static ErrorData *
+pgauditlogtofile_bench_edata(const char *message)
+{
+  ErrorData *edata = (ErrorData *)palloc0(sizeof(ErrorData));
+
+  edata->elevel = LOG;
+  edata->output_to_server = true;
+  edata->hide_stmt = true;
+  edata->filename = "pgaudit.c";
+  edata->lineno = 1;
+  edata->funcname = "log_audit_event";
+  edata->message = pstrdup(message);
+
+  return edata;
+}
+
+/**
+ * @brief Runs a case
+ * @param bench_case: case to run
+ * @param edata: record for the formatters and emit_log
+ * @param record: formatted record for the compressors
+ * @param records: number of iterations
+ * @param bytes: output, bytes produced (formatters and compressors) or filtered (emit_log)
+ * @param elapsed: output, time of all the iterations
+ * @return void
+ */
+static void
+pgauditlogtofile_bench_run(PgAuditLogToFileBenchCase bench_case, const ErrorData *edata,
+                           const StringInfo record, int64 records, uint64 *bytes, instr_time *elapsed)
+{
+  StringInfoData buf;
+  instr_time start;
+  char *dst = NULL;
+  size_t dst_len = 0;
+  size_t message_len = strlen(edata->message);
+  int64 n;
+
+  initStringInfo(&buf);
+  enlargeStringInfo(&buf, PGAUDIT_LTF_BENCH_RECORD_SIZE_INIT);
+
+  switch (bench_case)
+  {
+  case PGAUDIT_LTF_BENCH_GZIP:
+    guc_pgaudit_ltf_log_compression = PGAUDIT_LTF_COMPRESSION_GZIP;
+    break;
+  case PGAUDIT_LTF_BENCH_LZ4:
+    guc_pgaudit_ltf_log_compression = PGAUDIT_LTF_COMPRESSION_LZ4;
+    break;
+  case PGAUDIT_LTF_BENCH_ZSTD:
+    guc_pgaudit_ltf_log_compression = PGAUDIT_LTF_COMPRESSION_ZSTD;
+    break;
+  default:
+    guc_pgaudit_ltf_log_compression = PGAUDIT_LTF_COMPRESSION_OFF;
+    break;
+  }
+
+  INSTR_TIME_SET_CURRENT(start);
+  for (n = 0; n < records; n++)
+  {
+    switch (bench_case)
+    {
+    case PGAUDIT_LTF_BENCH_CSV:
+    case PGAUDIT_LTF_BENCH_CSV_PLAIN:
+      resetStringInfo(&buf);
+      PgAuditLogToFile_csv_audit(&buf, edata,
+                                 bench_case == PGAUDIT_LTF_BENCH_CSV ? PGAUDIT_LTF_BENCH_PREFIX_LENGTH : 0, NULL,
+                                 (uint64)n + 1);
+      *bytes += buf.len;
+      break;
+    case PGAUDIT_LTF_BENCH_JSON:
+    case PGAUDIT_LTF_BENCH_JSON_PLAIN:
+      resetStringInfo(&buf);
+      PgAuditLogToFile_json_audit(&buf, edata,
+                                  bench_case == PGAUDIT_LTF_BENCH_JSON ? PGAUDIT_LTF_BENCH_PREFIX_LENGTH : 0, NULL,
+                                  (uint64)n + 1);
+      *bytes += buf.len;
+      break;
+    case PGAUDIT_LTF_BENCH_GZIP:
+    case PGAUDIT_LTF_BENCH_LZ4:
+    case PGAUDIT_LTF_BENCH_ZSTD:
+      if (!PgAuditLogToFile_compress_audit(record->data, record->len, &dst, &dst_len))
+        ereport(ERROR, (errmsg("pgauditlogtofile: %s compression failed", pgaudit_ltf_bench_names[bench_case])));
+      *bytes += dst_len;
+      break;
+    case PGAUDIT_LTF_BENCH_REJECT:
+      PgAuditLogToFile_emit_log((ErrorData *)edata);
+      *bytes += message_len;
+      break;
+    default:
+      break;
+    }
+  }
+  INSTR_TIME_SET_CURRENT(*elapsed);
+  INSTR_TIME_SUBTRACT(*elapsed, start);
+
+  guc_pgaudit_ltf_log_compression = PGAUDIT_LTF_COMPRESSION_OFF;
+  pfree(buf.data);
+}
@@ -12,10 +12,13 @@
 #include "logtofile.h"
 
 #include "logtofile_bgw.h"
+#include "logtofile_close_barrier.h"
 #include "logtofile_connect.h"
 #include "logtofile_execution_hook.h"
+#include "logtofile_fault.h"
 #include "logtofile_guc.h"
 #include "logtofile_log.h"
+#include "logtofile_pending.h"
 #include "logtofile_shmem.h"
 #include "logtofile_vars.h"
 
@@ -108,6 +111,70 @@ void _PG_init(void)
       PGC_SIGHUP, GUC_NOT_IN_SAMPLE | GUC_UNIT_MIN | GUC_SUPERUSER_ONLY,
       NULL, NULL, NULL);
 
+  DefineCustomIntVariable(
+      "pgaudit.log_rotation_age_seconds",
+      "Automatic spool file rotation will occur after N seconds, overrides pgaudit.log_rotation_age (0 disables it)", NULL,
+      &guc_pgaudit_ltf_log_rotation_age_seconds,
+      0, 0, INT_MAX,
+      PGC_SIGHUP, GUC_NOT_IN_SAMPLE | GUC_UNIT_S | GUC_SUPERUSER_ONLY,
+      NULL, NULL, NULL);
+
+  DefineCustomIntVariable(
+      "pgaudit.log_rotation_nudge_delay",
+      "Signal the backends still holding a rotated audit file after N seconds (-1 disables it)", NULL,
+      &guc_pgaudit_ltf_log_rotation_nudge_delay,
+      -1, -1, INT_MAX,
+      PGC_SIGHUP, GUC_NOT_IN_SAMPLE | GUC_UNIT_S | GUC_SUPERUSER_ONLY,
+      NULL, NULL, NULL);
+
+  DefineCustomIntVariable(
+      "pgaudit.log_rotation_size",
+      "Automatic spool file rotation will occur after N kilobytes", NULL,
+      &guc_pgaudit_ltf_log_rotation_size,
+      0, 0, INT_MAX / 1024,
+      PGC_SIGHUP, GUC_NOT_IN_SAMPLE | GUC_UNIT_KB | GUC_SUPERUSER_ONLY,
+      NULL, NULL, NULL);
+
+  DefineCustomIntVariable(
+      "pgaudit.log_shards",
+      "Number of audit files written in parallel, backends are spread by their number", NULL,
+      &guc_pgaudit_ltf_log_shards,
+      1, 1, PGAUDIT_LTF_MAX_SHARDS,
+      PGC_SIGHUP, GUC_NOT_IN_SAMPLE | GUC_SUPERUSER_ONLY,
+      NULL, NULL, NULL);
+
+  DefineCustomIntVariable(
+      "pgaudit.log_retention_age",
+      "Closed audit files not modified for N seconds are removed", NULL,
+      &guc_pgaudit_ltf_log_retention_age,
+      0, 0, INT_MAX,
+      PGC_SIGHUP, GUC_NOT_IN_SAMPLE | GUC_UNIT_S | GUC_SUPERUSER_ONLY,
+      NULL, NULL, NULL);
+
+  DefineCustomIntVariable(
+      "pgaudit.log_retention_size",
+      "The oldest closed audit files are removed while all of them take more than N kilobytes", NULL,
+      &guc_pgaudit_ltf_log_retention_size,
+      0, 0, INT_MAX,
+      PGC_SIGHUP, GUC_NOT_IN_SAMPLE | GUC_UNIT_KB | GUC_SUPERUSER_ONLY,
+      NULL, NULL, NULL);
+
+  DefineCustomStringVariable(
+      "pgaudit.log_archive_command",
+      "Shell command to archive the closed audit files (%p path, %f file name)", NULL,
+      &guc_pgaudit_ltf_log_archive_command,
+      "",
+      PGC_SIGHUP, GUC_NOT_IN_SAMPLE | GUC_SUPERUSER_ONLY,
+      NULL, NULL, NULL);
+
+  DefineCustomIntVariable(
+      "pgaudit.log_archive_max_parallel",
+      "Maximum archive commands running at the same time", NULL,
+      &guc_pgaudit_ltf_log_archive_max_parallel,
+      1, 1, PGAUDIT_LTF_MAX_ARCHIVE_PARALLEL,
+      PGC_SIGHUP, GUC_NOT_IN_SAMPLE | GUC_SUPERUSER_ONLY,
+      NULL, NULL, NULL);
+
   DefineCustomBoolVariable(
       "pgaudit.log_connections",
       "Intercepts log_connections messages", NULL,
@@ -156,6 +223,71 @@ void _PG_init(void)
       PGC_POSTMASTER, GUC_NOT_IN_SAMPLE | GUC_SUPERUSER_ONLY,
       NULL, NULL, NULL);
 
+  DefineCustomIntVariable(
+      "pgaudit.log_execution_memory_sample_interval",
+      "Samples the statement memory every N plan node executions (0 = only at start and end of the run).", NULL,
+      &guc_pgaudit_ltf_log_execution_memory_sample_interval,
+      1000, 0, INT_MAX,
+      PGC_SIGHUP, GUC_NOT_IN_SAMPLE | GUC_SUPERUSER_ONLY,
+      NULL, NULL, NULL);
+
+  DefineCustomBoolVariable(
+      "pgaudit.log_execution_buffers",
+      "Logs the buffer, temporary file and WAL usage of each statement.", NULL,
+      &guc_pgaudit_ltf_log_execution_buffers,
+      false,
+      PGC_POSTMASTER, GUC_NOT_IN_SAMPLE | GUC_SUPERUSER_ONLY,
+      NULL, NULL, NULL);
+
+  DefineCustomBoolVariable(
+      "pgaudit.log_execution_jit",
+      "Logs the JIT compilation of each statement.", NULL,
+      &guc_pgaudit_ltf_log_execution_jit,
+      false,
+      PGC_POSTMASTER, GUC_NOT_IN_SAMPLE | GUC_SUPERUSER_ONLY,
+      NULL, NULL, NULL);
+
+  DefineCustomBoolVariable(
+      "pgaudit.log_execution_rusage",
+      "Logs the CPU time, context switches and storage I/O of each statement.", NULL,
+      &guc_pgaudit_ltf_log_execution_rusage,
+      false,
+      PGC_POSTMASTER, GUC_NOT_IN_SAMPLE | GUC_SUPERUSER_ONLY,
+      NULL, NULL, NULL);
+
+  DefineCustomBoolVariable(
+      "pgaudit.log_execution_parallel",
+      "Logs the number of parallel workers and the memory and CPU time of the leader plus its workers.", NULL,
+      &guc_pgaudit_ltf_log_execution_parallel,
+      false,
+      PGC_POSTMASTER, GUC_NOT_IN_SAMPLE | GUC_SUPERUSER_ONLY,
+      NULL, NULL, NULL);
+
+  DefineCustomIntVariable(
+      "pgaudit.log_execution_plan_min_duration",
+      "Adds the plan to the audit records of statements running at least this long.",
+      "-1 disables the plan capture, 0 captures the plan of every audited statement.",
+      &guc_pgaudit_ltf_log_execution_plan_min_duration,
+      -1, -1, INT_MAX,
+      PGC_SUSET, GUC_UNIT_MS | GUC_NOT_IN_SAMPLE | GUC_SUPERUSER_ONLY,
+      NULL, NULL, NULL);
+
+  DefineCustomBoolVariable(
+      "pgaudit.log_execution_plan_analyze",
+      "Adds the actual rows and timing of each plan node to the captured plan.", NULL,
+      &guc_pgaudit_ltf_log_execution_plan_analyze,
+      false,
+      PGC_SUSET, GUC_NOT_IN_SAMPLE | GUC_SUPERUSER_ONLY,
+      NULL, NULL, NULL);
+
+  DefineCustomBoolVariable(
+      "pgaudit.log_latency_histograms",
+      "Keeps latency histograms of the capture, format, compress and write stages of the audit records.", NULL,
+      &guc_pgaudit_ltf_log_latency_histograms,
+      false,
+      PGC_POSTMASTER, GUC_NOT_IN_SAMPLE | GUC_SUPERUSER_ONLY,
+      NULL, NULL, NULL);
+
   DefineCustomEnumVariable(
       "pgaudit.log_compression",
       "Compress the audit log file (off, gzip, lz4, zstd).", NULL,
@@ -172,6 +304,16 @@ void _PG_init(void)
       PGC_SIGHUP, GUC_NOT_IN_SAMPLE | GUC_SUPERUSER_ONLY,
       NULL, NULL, NULL);
 
+#ifdef PGAUDIT_LTF_FAULT_INJECTION
+  DefineCustomStringVariable(
+      "pgaudit.debug_fault_injection",
+      "Faults injected in the audit file open and write calls, for testing.", NULL,
+      &guc_pgaudit_ltf_debug_fault_injection,
+      "",
+      PGC_SUSET, GUC_NOT_IN_SAMPLE | GUC_SUPERUSER_ONLY,
+      PgAuditLogToFile_fault_check, PgAuditLogToFile_fault_assign, NULL);
+#endif
+
   EmitWarningsOnPlaceholders("pgauditlogtofile");
 
   /* background worker */
@@ -195,6 +337,13 @@ void _PG_init(void)
   pgaudit_ltf_prev_ExecutorRun = ExecutorRun_hook;
   ExecutorRun_hook = PgAuditLogToFile_ExecutorRun_Hook;
 
+  /* statements that fail never reach ExecutorEnd */
+  RegisterXactCallback(PgAuditLogToFile_Pending_XactCallback, NULL);
+  RegisterSubXactCallback(PgAuditLogToFile_Pending_SubXactCallback, NULL);
+
+  /* idle backends close the audit file at the end of the catchup transaction */
+  RegisterXactCallback(PgAuditLogToFile_close_barrier_XactCallback, NULL);
+
 /* backend hooks */
 #if (PG_VERSION_NUM >= 150000)
   pgaudit_ltf_prev_shmem_request_hook = shmem_request_hook;
@@ -222,6 +371,9 @@ void _PG_fini(void)
   ExecutorStart_hook = pgaudit_ltf_prev_ExecutorStart;
   ExecutorEnd_hook = pgaudit_ltf_prev_ExecutorEnd;
 
+  UnregisterXactCallback(PgAuditLogToFile_Pending_XactCallback, NULL);
+  UnregisterSubXactCallback(PgAuditLogToFile_Pending_SubXactCallback, NULL);
+
   if (pgaudit_ltf_memory_context != NULL)
   {
     MemoryContextDelete(pgaudit_ltf_memory_context);
@@ -0,0 +1,628 @@
+/*-------------------------------------------------------------------------
+ *
+ * logtofile_archive.c
+ *      Archive command for the closed audit files, pgaudit.log_archive_command
+ *
+ * Works like archive_command for the WAL. A file is marked with
+ * archive_status/<file>.pending in the audit directory when it becomes the
+ * current one. Once every backend closed it after a rotation, the worker
+ * replaces the mark with .ready and runs the command on it, up to
+ * pgaudit.log_archive_max_parallel at a time, without waiting for them.
+ * Success renames the mark to .done, failures are retried with an increasing
+ * delay.
+ *
+ * The marks survive restarts. A clean shutdown marks the current file .ready,
+ * it's complete by then. When the worker starts it queues the .ready files and
+ * retires again the .pending ones that are not the current file: the files
+ * still held by idle backends at a shutdown, the current file at a crash, or
+ * the retired files the worker forgot when it was restarted. They become
+ * .ready once no backend that could hold them is left.
+ *
+ * Copyright (c) 2026, Francisco Miguel Biete Banon
+ *
+ * This code is released under the PostgreSQL licence, as given at
+ *  http://www.postgresql.org/about/licence/
+ *-------------------------------------------------------------------------
+ */
+#include "logtofile_archive.h"
+
+#include "logtofile_filename.h"
+#include "logtofile_retired.h"
+#include "logtofile_vars.h"
+
+#include <access/htup_details.h>
+#include <funcapi.h>
+#include <lib/stringinfo.h>
+#include <miscadmin.h>
+#include <nodes/pg_list.h>
+#include <storage/fd.h>
+#include <storage/pg_shmem.h>
+#include <utils/builtins.h>
+#include <utils/memutils.h>
+#include <utils/timestamp.h>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+/* Defines */
+#define PGAUDIT_LTF_ARCHIVE_STATUS_DIR "archive_status"
+/* commands running are checked this often, their exit doesn't set our latch */
+#define PGAUDIT_LTF_ARCHIVE_POLL_MS 100
+#define PGAUDIT_LTF_ARCHIVE_RETRY_MIN_MS 1000
+#define PGAUDIT_LTF_ARCHIVE_RETRY_MAX_MS 60000
+#define PGAUDIT_LTF_ARCHIVE_STAT_COLS 8
+
+typedef struct PgAuditLogToFileArchiveFile
+{
+  char filename[MAXPGPATH];
+  int failures;
+  TimestampTz next_attempt;
+  /* command running on the file, 0 if none */
+  pid_t pid;
+} PgAuditLogToFileArchiveFile;
+
+/* variables to use only in this unit */
+static List *pgaudit_ltf_archive_files = NIL;
+static int pgaudit_ltf_archive_running = 0;
+static bool pgaudit_ltf_archive_loaded = false;
+
+/* forward declaration private functions */
+static void pgauditlogtofile_archive_status_path(char *path, const char *filename, const char *suffix);
+static bool pgauditlogtofile_archive_mark(const char *filename, const char *suffix);
+static bool pgauditlogtofile_archive_mark_ready(const char *filename);
+static void pgauditlogtofile_archive_add(const char *filename);
+static void pgauditlogtofile_archive_load(void);
+static void pgauditlogtofile_archive_reap(void);
+static void pgauditlogtofile_archive_launch(PgAuditLogToFileArchiveFile *file);
+static void pgauditlogtofile_archive_failed(PgAuditLogToFileArchiveFile *file, TimestampTz now);
+static void pgauditlogtofile_archive_command(StringInfo command, const char *filename);
+static void pgauditlogtofile_archive_publish(void);
+
+PG_FUNCTION_INFO_V1(pgauditlogtofile_archiver_stat);
+
+/* public methods */
+
+/**
+ * @brief Marks a new current file as pending, archived once it's retired and closed
+ * @param filename: audit file, one shard
+ * @return void
+ * @note Called by the postmaster at startup and by the background worker, before publishing the file
+ */
+void PgAuditLogToFile_archive_opened(const char *filename)
+{
+  if (guc_pgaudit_ltf_log_archive_command == NULL || guc_pgaudit_ltf_log_archive_command[0] == '\0')
+    return;
+
+  (void)pgauditlogtofile_archive_mark(filename, ".pending");
+}
+
+/**
+ * @brief Marks the current file for archiving, no backend writes to it anymore
+ * @param code: exit code of the postmaster
+ * @return void
+ * @note Called by the postmaster at exit, after every backend is gone
+ */
+void PgAuditLogToFile_archive_shutdown(int code)
+{
+  char filename[MAXPGPATH];
+  struct stat st;
+  int shard;
+
+  if (code != 0 || pgaudit_ltf_shm == NULL || guc_pgaudit_ltf_log_archive_command == NULL ||
+      guc_pgaudit_ltf_log_archive_command[0] == '\0' || pgaudit_ltf_shm->filename[0] == '\0')
+    return;
+
+  for (shard = 0; shard < pgaudit_ltf_shm->num_shards; shard++)
+  {
+    strlcpy(filename, pgaudit_ltf_shm->filename, MAXPGPATH);
+    PgAuditLogToFile_shard_filename(filename, shard, pgaudit_ltf_shm->num_shards);
+    if (stat(filename, &st) == 0)
+      (void)pgauditlogtofile_archive_mark_ready(filename);
+  }
+}
+
+/**
+ * @brief File closed action - marks the file for archiving
+ * @param filename: file closed by all backends
+ * @return void
+ */
+void PgAuditLogToFile_archive_closed(const char *filename)
+{
+  if (guc_pgaudit_ltf_log_archive_command == NULL || guc_pgaudit_ltf_log_archive_command[0] == '\0')
+    return;
+
+  if (pgauditlogtofile_archive_mark_ready(filename))
+    pgauditlogtofile_archive_add(filename);
+}
+
+/**
+ * @brief Collects the finished commands and starts new ones
+ * @param void
+ * @return long - milliseconds until the next check, -1 if there is nothing to do
+ */
+long PgAuditLogToFile_archive_run(void)
+{
+  TimestampTz now;
+  TimestampTz next_attempt = 0;
+  ListCell *lc;
+
+  if (!pgaudit_ltf_archive_loaded)
+  {
+    pgauditlogtofile_archive_load();
+    pgaudit_ltf_archive_loaded = true;
+  }
+
+  if (pgaudit_ltf_archive_files == NIL)
+    return -1;
+
+  pgauditlogtofile_archive_reap();
+
+  now = GetCurrentTimestamp();
+  foreach (lc, pgaudit_ltf_archive_files)
+  {
+    PgAuditLogToFileArchiveFile *file = (PgAuditLogToFileArchiveFile *)lfirst(lc);
+
+    if (guc_pgaudit_ltf_log_archive_command == NULL || guc_pgaudit_ltf_log_archive_command[0] == '\0')
+      break;
+    if (pgaudit_ltf_archive_running >= guc_pgaudit_ltf_log_archive_max_parallel)
+      break;
+    /* written again after a restart, it will be marked again when it's closed */
+    if (file->pid != 0 || PgAuditLogToFile_retired_in_use(file->filename))
+      continue;
+
+    if (file->next_attempt > now)
+    {
+      if (next_attempt == 0 || file->next_attempt < next_attempt)
+        next_attempt = file->next_attempt;
+      continue;
+    }
+
+    pgauditlogtofile_archive_launch(file);
+    if (file->pid == 0)
+      pgauditlogtofile_archive_failed(file, now);
+  }
+
+  pgauditlogtofile_archive_publish();
+
+  if (pgaudit_ltf_archive_running > 0)
+    return PGAUDIT_LTF_ARCHIVE_POLL_MS;
+  if (next_attempt != 0)
+    return Max(TimestampDifferenceMilliseconds(now, next_attempt), 1);
+
+  return -1;
+}
+
+/**
+ * @brief Checks if a file is waiting to be archived
+ * @param filename: audit file
+ * @return bool - true if the archive command didn't succeed on it yet
+ */
+bool PgAuditLogToFile_archive_pending(const char *filename)
+{
+  ListCell *lc;
+
+  foreach (lc, pgaudit_ltf_archive_files)
+  {
+    PgAuditLogToFileArchiveFile *file = (PgAuditLogToFileArchiveFile *)lfirst(lc);
+
+    if (strcmp(file->filename, filename) == 0)
+      return true;
+  }
+
+  return false;
+}
+
+/**
+ * @brief Removes the archive status of a file removed by the retention
+ * @param filename: audit file
+ * @return void
+ */
+void PgAuditLogToFile_archive_forget(const char *filename)
+{
+  char path[MAXPGPATH];
+
+  pgauditlogtofile_archive_status_path(path, filename, ".done");
+  if (unlink(path) != 0 && errno != ENOENT)
+    ereport(LOG, (errcode_for_file_access(),
+                  errmsg("pgauditlogtofile could not remove file \"%s\": %m", path)));
+}
+
+/**
+ * @brief SQL function - statistics of the archive command
+ * @return Datum - one record
+ */
+Datum pgauditlogtofile_archiver_stat(PG_FUNCTION_ARGS)
+{
+  TupleDesc tupdesc;
+  PgAuditLogToFileArchiveStats stats;
+  Datum values[PGAUDIT_LTF_ARCHIVE_STAT_COLS];
+  bool nulls[PGAUDIT_LTF_ARCHIVE_STAT_COLS];
+  int i = 0;
+
+  if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+    elog(ERROR, "return type must be a row type");
+
+  if (UsedShmemSegAddr == NULL || pgaudit_ltf_shm == NULL)
+    ereport(ERROR,
+            (errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+             errmsg("pgauditlogtofile must be loaded via shared_preload_libraries")));
+
+  LWLockAcquire(&pgaudit_ltf_shm->lock, LW_SHARED);
+  memcpy(&stats, &pgaudit_ltf_shm->archive_stats, sizeof(PgAuditLogToFileArchiveStats));
+  LWLockRelease(&pgaudit_ltf_shm->lock);
+
+  memset(nulls, 0, sizeof(nulls));
+
+  values[i++] = Int64GetDatum((int64)stats.archived_count);
+  if (stats.last_archived_file[0] != '\0')
+  {
+    values[i++] = CStringGetTextDatum(stats.last_archived_file);
+    values[i++] = TimestampTzGetDatum(stats.last_archived_time);
+  }
+  else
+  {
+    nulls[i++] = true;
+    nulls[i++] = true;
+  }
+  values[i++] = Int64GetDatum((int64)stats.failed_count);
+  if (stats.last_failed_file[0] != '\0')
+  {
+    values[i++] = CStringGetTextDatum(stats.last_failed_file);
+    values[i++] = TimestampTzGetDatum(stats.last_failed_time);
+  }
+  else
+  {
+    nulls[i++] = true;
+    nulls[i++] = true;
+  }
+  values[i++] = Int32GetDatum(stats.pending);
+  values[i++] = Int32GetDatum(stats.running);
+
+  Assert(i == PGAUDIT_LTF_ARCHIVE_STAT_COLS);
+
+  PG_RETURN_DATUM(HeapTupleGetDatum(heap_form_tuple(BlessTupleDesc(tupdesc), values, nulls)));
+}
+
+/* private functions */
+
+/**
+ * @brief Path of the archive status of a file, in the archive_status directory next to it
+ * @param path: buffer of MAXPGPATH bytes
+ * @param filename: audit file
+ * @param suffix: ".ready" or ".done"
+ * @return void
+ */
+static void
+pgauditlogtofile_archive_status_path(char *path, const char *filename, const char *suffix)
+{
+  const char *basename = last_dir_separator(filename);
+
+  if (basename == NULL)
+    pg_snprintf(path, MAXPGPATH, "%s/%s%s", PGAUDIT_LTF_ARCHIVE_STATUS_DIR, filename, suffix);
+  else
+    pg_snprintf(path, MAXPGPATH, "%.*s/%s/%s%s", (int)(basename - filename), filename,
+                PGAUDIT_LTF_ARCHIVE_STATUS_DIR, basename + 1, suffix);
+}
+
+/**
+ * @brief Creates an archive status of a file, durably
+ * @param filename: audit file
+ * @param suffix: ".pending" or ".ready"
+ * @return bool - true if created, or it already existed
+ */
+static bool
+pgauditlogtofile_archive_mark(const char *filename, const char *suffix)
+{
+  char path[MAXPGPATH];
+  char *separator;
+  struct stat st;
+  int fd;
+
+  pgauditlogtofile_archive_status_path(path, filename, suffix);
+
+  /* the same file can become the current one again */
+  if (stat(path, &st) == 0)
+    return true;
+
+  /* the archive_status directory */
+  separator = last_dir_separator(path);
+  *separator = '\0';
+  (void)MakePGDirectory(path);
+  *separator = '/';
+
+  fd = OpenTransientFile(path, O_CREAT | O_WRONLY | PG_BINARY);
+  if (fd < 0)
+  {
+    ereport(LOG, (errcode_for_file_access(),
+                  errmsg("pgauditlogtofile could not create archive status file \"%s\": %m", path)));
+    return false;
+  }
+  CloseTransientFile(fd);
+
+  /* the file and the directory */
+  fsync_fname(path, false);
+  *separator = '\0';
+  fsync_fname(path, true);
+
+  return true;
+}
+
+/**
+ * @brief Replaces the .pending status of a file with .ready
+ * @param filename: audit file
+ * @return bool - true if the .ready status exists
+ * @note A crash in between leaves both, the .pending one is retired again and finds the file .ready
+ */
+static bool
+pgauditlogtofile_archive_mark_ready(const char *filename)
+{
+  char path[MAXPGPATH];
+
+  if (!pgauditlogtofile_archive_mark(filename, ".ready"))
+    return false;
+
+  pgauditlogtofile_archive_status_path(path, filename, ".pending");
+  if (unlink(path) != 0 && errno != ENOENT)
+    ereport(LOG, (errcode_for_file_access(),
+                  errmsg("pgauditlogtofile could not remove file \"%s\": %m", path)));
+
+  return true;
+}
+
+/**
+ * @brief Queues a file for the archive command, once
+ * @param filename: audit file
+ * @return void
+ */
+static void
+pgauditlogtofile_archive_add(const char *filename)
+{
+  MemoryContext old_context;
+  PgAuditLogToFileArchiveFile *file;
+
+  if (PgAuditLogToFile_archive_pending(filename))
+    return;
+
+  /* survives the loop context of the worker */
+  old_context = MemoryContextSwitchTo(pgaudit_ltf_memory_context);
+  file = (PgAuditLogToFileArchiveFile *)palloc0(sizeof(PgAuditLogToFileArchiveFile));
+  strlcpy(file->filename, filename, MAXPGPATH);
+  pgaudit_ltf_archive_files = lappend(pgaudit_ltf_archive_files, file);
+  MemoryContextSwitchTo(old_context);
+}
+
+/**
+ * @brief Queues the files marked .ready by a previous run and retires again the .pending ones
+ * @param void
+ * @return void
+ * @note Backends that opened a file before the worker started may still hold it, the retired files wait for them
+ */
+static void
+pgauditlogtofile_archive_load(void)
+{
+  char status_dir[MAXPGPATH];
+  char filename[MAXPGPATH];
+  struct stat st;
+  DIR *dir;
+  struct dirent *de;
+  uint32 generation = pg_atomic_read_u32(&pgaudit_ltf_shm->rotation_generation);
+  int retired = 0;
+
+  if (guc_pgaudit_ltf_log_directory == NULL || guc_pgaudit_ltf_log_directory[0] == '\0')
+    return;
+
+  pg_snprintf(status_dir, MAXPGPATH, "%s/%s", guc_pgaudit_ltf_log_directory, PGAUDIT_LTF_ARCHIVE_STATUS_DIR);
+  if (stat(status_dir, &st) != 0)
+    return;
+
+  dir = AllocateDir(status_dir);
+  while ((de = ReadDirExtended(dir, status_dir, LOG)) != NULL)
+  {
+    size_t len = strlen(de->d_name);
+
+    if (len > strlen(".pending") && strcmp(de->d_name + len - strlen(".pending"), ".pending") == 0)
+    {
+      pg_snprintf(filename, MAXPGPATH, "%s/%.*s", guc_pgaudit_ltf_log_directory,
+                  (int)(len - strlen(".pending")), de->d_name);
+
+      /* the current file, or retired already by this worker */
+      if (PgAuditLogToFile_retired_in_use(filename))
+        continue;
+
+      /* any backend that opened a file before the current one may hold it, wraparound-aware */
+      PgAuditLogToFile_retired_add(generation - 1, filename, 1);
+      retired++;
+      continue;
+    }
+
+    if (len <= strlen(".ready") || strcmp(de->d_name + len - strlen(".ready"), ".ready") != 0)
+      continue;
+
+    pg_snprintf(filename, MAXPGPATH, "%s/%.*s", guc_pgaudit_ltf_log_directory,
+                (int)(len - strlen(".ready")), de->d_name);
+    pgauditlogtofile_archive_add(filename);
+  }
+  FreeDir(dir);
+
+  if (pgaudit_ltf_archive_files != NIL || retired > 0)
+    ereport(LOG, (errmsg("pgauditlogtofile bgw: %d audit files waiting to be archived, %d waiting to be closed",
+                         list_length(pgaudit_ltf_archive_files), retired)));
+}
+
+/**
+ * @brief Collects the commands that finished
+ * @param void
+ * @return void
+ */
+static void
+pgauditlogtofile_archive_reap(void)
+{
+  TimestampTz now = GetCurrentTimestamp();
+  ListCell *lc;
+
+  if (pgaudit_ltf_archive_running == 0)
+    return;
+
+  foreach (lc, pgaudit_ltf_archive_files)
+  {
+    PgAuditLogToFileArchiveFile *file = (PgAuditLogToFileArchiveFile *)lfirst(lc);
+    char ready[MAXPGPATH];
+    char done[MAXPGPATH];
+    int status;
+    pid_t rc;
+
+    if (file->pid == 0)
+      continue;
+
+    rc = waitpid(file->pid, &status, WNOHANG);
+    if (rc == 0)
+      continue;
+
+    file->pid = 0;
+    pgaudit_ltf_archive_running--;
+
+    if (rc < 0 || status != 0)
+    {
+      StringInfoData command;
+
+      initStringInfo(&command);
+      pgauditlogtofile_archive_command(&command, file->filename);
+      ereport(LOG, (errmsg("pgauditlogtofile archive command failed for \"%s\": %s", file->filename,
+                           rc < 0 ? "could not wait for the command" : wait_result_to_str(status)),
+                    errdetail("The failed archive command was: %s", command.data)));
+      pgauditlogtofile_archive_failed(file, now);
+      continue;
+    }
+
+    pgauditlogtofile_archive_status_path(ready, file->filename, ".ready");
+    pgauditlogtofile_archive_status_path(done, file->filename, ".done");
+    (void)durable_rename(ready, done, LOG);
+
+    ereport(DEBUG1, (errmsg("pgauditlogtofile archived audit file \"%s\"", file->filename)));
+
+    LWLockAcquire(&pgaudit_ltf_shm->lock, LW_EXCLUSIVE);
+    pgaudit_ltf_shm->archive_stats.archived_count++;
+    strlcpy(pgaudit_ltf_shm->archive_stats.last_archived_file, file->filename, MAXPGPATH);
+    pgaudit_ltf_shm->archive_stats.last_archived_time = now;
+    LWLockRelease(&pgaudit_ltf_shm->lock);
+
+    pgaudit_ltf_archive_files = foreach_delete_current(pgaudit_ltf_archive_files, lc);
+    pfree(file);
+  }
+}
+
+/**
+ * @brief Starts the archive command on a file, without waiting for it
+ * @param file: file to archive, its pid is set if the command started
+ * @return void
+ */
+static void
+pgauditlogtofile_archive_launch(PgAuditLogToFileArchiveFile *file)
+{
+  StringInfoData command;
+  pid_t pid;
+
+  initStringInfo(&command);
+  pgauditlogtofile_archive_command(&command, file->filename);
+
+  ereport(DEBUG3, (errmsg("pgauditlogtofile executing archive command \"%s\"", command.data)));
+
+  /* like system(), the output buffered by us must not be written twice */
+  fflush(NULL);
+  pid = fork();
+  if (pid == 0)
+  {
+    execl("/bin/sh", "sh", "-c", command.data, (char *)NULL);
+    _exit(127);
+  }
+
+  if (pid < 0)
+  {
+    ereport(LOG, (errmsg("pgauditlogtofile could not start archive command for \"%s\": %m", file->filename)));
+    return;
+  }
+
+  file->pid = pid;
+  pgaudit_ltf_archive_running++;
+}
+
+/**
+ * @brief Counts a failure and delays the next attempt, doubling the delay up to a minute
+ * @param file: file that failed
+ * @param now: current time
+ * @return void
+ */
+static void
+pgauditlogtofile_archive_failed(PgAuditLogToFileArchiveFile *file, TimestampTz now)
+{
+  long delay_ms = PGAUDIT_LTF_ARCHIVE_RETRY_MAX_MS;
+
+  if (file->failures < 6)
+    delay_ms = Min((long)PGAUDIT_LTF_ARCHIVE_RETRY_MIN_MS << file->failures, PGAUDIT_LTF_ARCHIVE_RETRY_MAX_MS);
+  file->failures++;
+  file->next_attempt = TimestampTzPlusMilliseconds(now, delay_ms);
+
+  LWLockAcquire(&pgaudit_ltf_shm->lock, LW_EXCLUSIVE);
+  pgaudit_ltf_shm->archive_stats.failed_count++;
+  strlcpy(pgaudit_ltf_shm->archive_stats.last_failed_file, file->filename, MAXPGPATH);
+  pgaudit_ltf_shm->archive_stats.last_failed_time = now;
+  LWLockRelease(&pgaudit_ltf_shm->lock);
+}
+
+/**
+ * @brief Expands pgaudit.log_archive_command: %p path of the file, %f name of the file, %% a %
+ * @param command: result
+ * @param filename: audit file
+ * @return void
+ */
+static void
+pgauditlogtofile_archive_command(StringInfo command, const char *filename)
+{
+  const char *basename = last_dir_separator(filename);
+  const char *p;
+
+  basename = (basename == NULL) ? filename : basename + 1;
+
+  for (p = guc_pgaudit_ltf_log_archive_command; *p != '\0'; p++)
+  {
+    if (*p == '%' && p[1] == 'p')
+    {
+      appendStringInfoString(command, filename);
+      p++;
+    }
+    else if (*p == '%' && p[1] == 'f')
+    {
+      appendStringInfoString(command, basename);
+      p++;
+    }
+    else if (*p == '%' && p[1] == '%')
+    {
+      appendStringInfoChar(command, '%');
+      p++;
+    }
+    else
+      appendStringInfoChar(command, *p);
+  }
+}
+
+/**
+ * @brief Publishes the files waiting and the commands running
+ * @param void
+ * @return void
+ */
+static void
+pgauditlogtofile_archive_publish(void)
+{
+  int pending = list_length(pgaudit_ltf_archive_files);
+
+  if (pgaudit_ltf_shm->archive_stats.pending == pending &&
+      pgaudit_ltf_shm->archive_stats.running == pgaudit_ltf_archive_running)
+    return;
+
+  LWLockAcquire(&pgaudit_ltf_shm->lock, LW_EXCLUSIVE);
+  pgaudit_ltf_shm->archive_stats.pending = pending;
+  pgaudit_ltf_shm->archive_stats.running = pgaudit_ltf_archive_running;
+  LWLockRelease(&pgaudit_ltf_shm->lock);
+}
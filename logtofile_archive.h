@@ -0,0 +1,33 @@
+/*-------------------------------------------------------------------------
+ *
+ * logtofile_archive.h
+ *      Archive command for the closed audit files, pgaudit.log_archive_command
+ *
+ * Copyright (c) 2026, Francisco Miguel Biete Banon
+ *
+ * This code is released under the PostgreSQL licence, as given at
+ *  http://www.postgresql.org/about/licence/
+ *-------------------------------------------------------------------------
+ */
+#ifndef _LOGTOFILE_ARCHIVE_H_
+#define _LOGTOFILE_ARCHIVE_H_
+
+#include <postgres.h>
+#include <fmgr.h>
+
+/* Postmaster */
+extern void PgAuditLogToFile_archive_shutdown(int code);
+
+/* Postmaster and background worker */
+extern void PgAuditLogToFile_archive_opened(const char *filename);
+
+/* Background worker */
+extern void PgAuditLogToFile_archive_closed(const char *filename);
+extern long PgAuditLogToFile_archive_run(void);
+extern bool PgAuditLogToFile_archive_pending(const char *filename);
+extern void PgAuditLogToFile_archive_forget(const char *filename);
+
+/* SQL functions */
+extern Datum pgauditlogtofile_archiver_stat(PG_FUNCTION_ARGS);
+
+#endif
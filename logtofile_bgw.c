@@ -30,10 +30,19 @@
 #include <utils/memutils.h>
 #include <utils/timestamp.h>
 
+#include "logtofile_archive.h"
+#include "logtofile_close_barrier.h"
 #include "logtofile_filename.h"
+#include "logtofile_probes.h"
+#include "logtofile_retention.h"
+#include "logtofile_retired.h"
+#include "logtofile_sequence.h"
 #include "logtofile_shmem.h"
 #include "logtofile_vars.h"
 
+/* Defines */
+#define PGAUDIT_LTF_CLOSE_BARRIER_RECHECK_MS 1000
+
 /*
  * Wait events for pg_stat_activity visibility.
  */
@@ -52,6 +61,7 @@ static volatile sig_atomic_t got_sigusr1 = false;
 static void pgauditlogtofile_sigterm(SIGNAL_ARGS);
 static void pgauditlogtofile_sigusr1(SIGNAL_ARGS);
 static void pgauditlogtofile_rotate_file(uint32 wait_event_info);
+static long pgauditlogtofile_sleep_ms(void);
 
 /**
  * @brief Main entry point for the background worker
@@ -60,7 +70,7 @@ static void pgauditlogtofile_rotate_file(uint32 wait_event_info);
  */
 void PgAuditLogToFileMain(Datum arg)
 {
-  int sleep_ms = SECS_PER_MINUTE * 1000;
+  uint64 close_generation = 0;
   MemoryContext PgAuditLogToFileContext = NULL;
 
   /* Register custom wait events for visibility in pg_stat_activity */
@@ -89,9 +99,19 @@ void PgAuditLogToFileMain(Datum arg)
 
   pgstat_report_appname("pgauditlogtofile launcher");
 
+  /* preallocated blocks that the retired files will never use */
+  PgAuditLogToFile_retired_register_action(PgAuditLogToFile_trim_file);
+  PgAuditLogToFile_retired_register_action(PgAuditLogToFile_archive_closed);
+  PgAuditLogToFile_retired_startup();
+
   PgAuditLogToFileContext = AllocSetContextCreate(pgaudit_ltf_memory_context, "pgauditlogtofile loop context",
                                                   ALLOCSET_DEFAULT_MINSIZE, ALLOCSET_DEFAULT_INITSIZE, ALLOCSET_DEFAULT_MAXSIZE);
 
+  /* backends acknowledging a close barrier wake us up */
+  LWLockAcquire(&pgaudit_ltf_shm->lock, LW_EXCLUSIVE);
+  pgaudit_ltf_shm->worker_latch = &MyProc->procLatch;
+  LWLockRelease(&pgaudit_ltf_shm->lock);
+
   ereport(LOG_SERVER_ONLY, (errmsg("pgauditlogtofile worker started")));
 
   MemoryContextSwitchTo(PgAuditLogToFileContext);
@@ -99,51 +119,30 @@ void PgAuditLogToFileMain(Datum arg)
   while (1)
   {
     int rc;
+    long sleep_ms;
+    long idle_ms = -1;
+    long archive_ms;
+    long retention_ms;
+    int retired;
 
     CHECK_FOR_INTERRUPTS();
 
-    /* Propagate SIGUSR1 from the bwg to all backends to force an audit file descriptor closure */
+    /* Raise a close barrier on SIGUSR1, only the backends holding the audit file open are signaled */
     if (got_sigusr1)
     {
-      int i;
-      PGPROC *proc;
-
       got_sigusr1 = false;
       pgstat_report_wait_start(pgaudit_wait_signal);
 
-      ereport(LOG, (errmsg("pgauditlogtofile bgw: received SIGUSR1, propagating to backends")));
+      ereport(LOG, (errmsg("pgauditlogtofile bgw: received SIGUSR1, closing the audit file in all backends")));
+      close_generation = PgAuditLogToFile_close_barrier_emit();
 
-      /*
-       * Acquire a shared lock on the ProcArray to safely iterate
-       * through active backends.
-       */
-      LWLockAcquire(ProcArrayLock, LW_SHARED);
-
-      for (i = 0; i < ProcGlobal->allProcCount; i++)
-      {
-        proc = &ProcGlobal->allProcs[i];
-
-        /* Don't signal yourself (the background worker) */
-        if (proc->pid != MyProcPid && proc->pid != 0)
-        {
-          /* Send the actual signal via the OS */
-          kill(proc->pid, SIGUSR1);
-        }
-      }
-
-      LWLockRelease(ProcArrayLock);
       pgstat_report_wait_end();
     }
 
-    if (guc_pgaudit_ltf_log_rotation_age > 0 && guc_pgaudit_ltf_log_rotation_age < 5)
+    if (close_generation != 0 && PgAuditLogToFile_close_barrier_pending(close_generation) == 0)
     {
-      // very small rotation, wake up frequently - this has a performance impact,
-      // but rotation every a few minutes should only be done for testing
-      sleep_ms = 10000;
-    }
-    else
-    {
-      sleep_ms = SECS_PER_MINUTE * 1000;
+      ereport(LOG, (errmsg("pgauditlogtofile bgw: all backends closed the audit file")));
+      close_generation = 0;
     }
 
     ereport(DEBUG5, (errmsg("pgauditlogtofile bgw loop")));
@@ -160,12 +159,42 @@ void PgAuditLogToFileMain(Datum arg)
       pgauditlogtofile_rotate_file(pgaudit_wait_rotate);
     }
 
+    /* files retired by a rotation that every backend closed */
+    retired = PgAuditLogToFile_retired_process();
+
+    /* backends using half of the reserved sequence numbers wake us up */
+    PgAuditLogToFile_sequence_reserve();
+
+    /* archive commands of the closed files, before the retention looks for the ones still pending */
+    archive_ms = PgAuditLogToFile_archive_run();
+
+    /* old files past pgaudit.log_retention_age or pgaudit.log_retention_size */
+    retention_ms = PgAuditLogToFile_retention_enforce();
+
+    /* backends without audit records for a while close their file */
+    if (guc_pgaudit_ltf_auto_close_minutes > 0)
+      idle_ms = PgAuditLogToFile_close_barrier_idle(guc_pgaudit_ltf_auto_close_minutes * SECS_PER_MINUTE);
+
     /* shutdown if requested */
     if (got_sigterm)
       break;
 
-    rc = WaitLatch(&MyProc->procLatch, WL_LATCH_SET | WL_TIMEOUT | WL_POSTMASTER_DEATH, sleep_ms,
-                   pgaudit_wait_main);
+    /* sleep until the next rotation, signals and reloads set the latch */
+    sleep_ms = pgauditlogtofile_sleep_ms();
+    /* acknowledgements and closes set the latch, but backends can also exit without one */
+    if ((close_generation != 0 || retired > 0) && (sleep_ms < 0 || sleep_ms > PGAUDIT_LTF_CLOSE_BARRIER_RECHECK_MS))
+      sleep_ms = PGAUDIT_LTF_CLOSE_BARRIER_RECHECK_MS;
+    if (idle_ms >= 0 && (sleep_ms < 0 || sleep_ms > idle_ms))
+      sleep_ms = idle_ms;
+    if (retention_ms >= 0 && (sleep_ms < 0 || sleep_ms > retention_ms))
+      sleep_ms = retention_ms;
+    if (archive_ms >= 0 && (sleep_ms < 0 || sleep_ms > archive_ms))
+      sleep_ms = archive_ms;
+    if (sleep_ms < 0)
+      rc = WaitLatch(&MyProc->procLatch, WL_LATCH_SET | WL_POSTMASTER_DEATH, -1L, pgaudit_wait_main);
+    else
+      rc = WaitLatch(&MyProc->procLatch, WL_LATCH_SET | WL_TIMEOUT | WL_POSTMASTER_DEATH, sleep_ms,
+                     pgaudit_wait_main);
     if (rc & WL_POSTMASTER_DEATH)
       proc_exit(1);
 
@@ -173,6 +202,10 @@ void PgAuditLogToFileMain(Datum arg)
     MemoryContextReset(PgAuditLogToFileContext);
   }
 
+  LWLockAcquire(&pgaudit_ltf_shm->lock, LW_EXCLUSIVE);
+  pgaudit_ltf_shm->worker_latch = NULL;
+  LWLockRelease(&pgaudit_ltf_shm->lock);
+
   ereport(LOG_SERVER_ONLY, (errmsg("pgauditlogtofile worker shutting down")));
 
   proc_exit(0);
@@ -221,10 +254,44 @@ pgauditlogtofile_sigterm(SIGNAL_ARGS)
 static void
 pgauditlogtofile_rotate_file(uint32 wait_event_info)
 {
+  char old_filename[MAXPGPATH];
+  uint32 old_generation;
+  int old_num_shards;
+
   pgstat_report_wait_start(wait_event_info);
 
+  /* only the worker writes them */
+  strlcpy(old_filename, pgaudit_ltf_shm->filename, MAXPGPATH);
+  old_generation = pg_atomic_read_u32(&pgaudit_ltf_shm->rotation_generation);
+  old_num_shards = pgaudit_ltf_shm->num_shards;
+
   PgAuditLogToFile_calculate_current_filename();
   PgAuditLogToFile_set_next_rotation_time();
+  PGAUDITLOGTOFILE_ROTATE(MyProcPid, pgaudit_ltf_shm->filename);
+
+  if (old_filename[0] != '\0' &&
+      (strcmp(old_filename, pgaudit_ltf_shm->filename) != 0 || old_num_shards != pgaudit_ltf_shm->num_shards))
+    PgAuditLogToFile_retired_add(old_generation, old_filename, old_num_shards);
 
   pgstat_report_wait_end();
-}
\ No newline at end of file
+}
+
+/**
+ * @brief Time until the next rotation, rounded up so we never wake up before it
+ * @param void
+ * @return long - milliseconds, -1 if time-based rotation is disabled
+ */
+static long
+pgauditlogtofile_sleep_ms(void)
+{
+  pg_time_t next_rotation_time;
+
+  if (PgAuditLogToFile_rotation_interval() < 1)
+    return -1;
+
+  LWLockAcquire(&pgaudit_ltf_shm->lock, LW_SHARED);
+  next_rotation_time = pgaudit_ltf_shm->next_rotation_time;
+  LWLockRelease(&pgaudit_ltf_shm->lock);
+
+  return TimestampDifferenceMilliseconds(GetCurrentTimestamp(), time_t_to_timestamptz(next_rotation_time));
+}
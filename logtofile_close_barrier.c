@@ -0,0 +1,405 @@
+/*-------------------------------------------------------------------------
+ *
+ * logtofile_close_barrier.c
+ *      Barrier to make the backends close their audit file descriptor
+ *
+ * The worker advances close_generation and signals only the backends whose
+ * slot says they hold the audit file open. Each one closes its descriptor,
+ * acknowledges the generation in its slot and sets the worker latch, so the
+ * worker knows when every handle of the old file is gone.
+ *
+ * The slots also register the rotation generation of the open file, so the
+ * worker knows when the files retired by a rotation have no holders left, and
+ * the time of the last record, so it can ask the idle ones to close it.
+ *
+ * The worker publishes the new file name and then advances
+ * rotation_generation. A backend opening the file does the reverse: it reads
+ * the generation, registers it with fd_open set, reads the name, opens it and
+ * reads the generation again, retrying if it moved. So when the worker counts
+ * the holders of a retired generation, a backend that may have read the old
+ * name is either registered already, or will see the new generation and close
+ * the old file without writing to it.
+ *
+ * The signal handler only takes note of the request. The backend closes the
+ * file at a safe point: before and after each record, and at the end of each
+ * transaction. The worker sends a catchup interrupt, so an idle backend runs a
+ * short transaction to process it and closes the file there. A backend idle in
+ * a transaction, or a background worker that never waits for a client, closes
+ * it at its next record or transaction end.
+ *
+ * Copyright (c) 2026, Francisco Miguel Biete Banon
+ *
+ * This code is released under the PostgreSQL licence, as given at
+ *  http://www.postgresql.org/about/licence/
+ *-------------------------------------------------------------------------
+ */
+#include "logtofile_close_barrier.h"
+
+#include "logtofile_shmem.h"
+#include "logtofile_vars.h"
+
+#include <miscadmin.h>
+#include <port/atomics.h>
+#include <storage/ipc.h>
+#include <storage/latch.h>
+#include <storage/pg_shmem.h>
+#include <storage/proc.h>
+#include <storage/procsignal.h>
+
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+
+/* variables to use only in this unit */
+static PgAuditLogToFileBackend *pgaudit_ltf_barrier_slot = NULL;
+static bool pgaudit_ltf_barrier_released = false;
+static volatile sig_atomic_t pgaudit_ltf_barrier_signaled = false;
+
+/* forward declaration private functions */
+static void pgauditlogtofile_close_barrier_release(int code, Datum arg);
+static bool pgauditlogtofile_close_barrier_stale(const PgAuditLogToFileBackend *slot);
+static void pgauditlogtofile_close_barrier_wakeup(void);
+static void pgauditlogtofile_close_barrier_signal(int procno, int pid);
+
+/* public methods */
+
+/**
+ * @brief Marks the audit file as open by this backend, before reading its name
+ * @param generation: rotation generation read before the name
+ * @return void
+ * @note PgAuditLogToFile_close_barrier_closed undoes it if the file can't be opened
+ */
+void PgAuditLogToFile_close_barrier_opening(uint32 generation)
+{
+  if (pgaudit_ltf_barrier_slot == NULL)
+  {
+    /* exiting backend (disconnection record) or postmaster */
+    if (pgaudit_ltf_barrier_released || MyProc == NULL)
+      return;
+
+    pgaudit_ltf_barrier_slot = PgAuditLogToFile_backend_slot(MyProc);
+    if (pgaudit_ltf_barrier_slot == NULL)
+      return;
+
+    before_shmem_exit(pgauditlogtofile_close_barrier_release, (Datum)0);
+  }
+
+  /*
+   * Publish the descriptor before reading the close generation and the file
+   * name: a worker that advances them after our read will see the descriptor
+   * and signal us, one that advanced them before is asking for older
+   * descriptors than this one.
+   */
+  pg_atomic_write_u32(&pgaudit_ltf_barrier_slot->open_generation, generation);
+  pg_atomic_write_u64(&pgaudit_ltf_barrier_slot->last_write, (uint64)time(NULL));
+  pg_atomic_write_u32(&pgaudit_ltf_barrier_slot->idle_close, 0);
+  pg_atomic_write_u32(&pgaudit_ltf_barrier_slot->fd_open, 1);
+  pg_memory_barrier();
+  pg_atomic_write_u64(&pgaudit_ltf_barrier_slot->close_ack,
+                      pg_atomic_read_u64(&pgaudit_ltf_shm->close_generation));
+}
+
+/**
+ * @brief Marks the audit file as closed by this backend
+ * @param void
+ * @return void
+ */
+void PgAuditLogToFile_close_barrier_closed(void)
+{
+  PgAuditLogToFileBackend *slot = pgaudit_ltf_barrier_slot;
+
+  if (slot == NULL)
+    return;
+
+  pg_atomic_write_u32(&slot->fd_open, 0);
+
+  /* we may be the last holder of a retired file */
+  if (pgauditlogtofile_close_barrier_stale(slot))
+    pgauditlogtofile_close_barrier_wakeup();
+}
+
+/**
+ * @brief Starts writing a record, absorbing the close requests received until now
+ * @param void
+ * @return void
+ */
+void PgAuditLogToFile_close_barrier_enter(void)
+{
+  PgAuditLogToFile_close_barrier_absorb();
+}
+
+/**
+ * @brief Finishes writing a record, publishes the activity and absorbs the deferred close requests
+ * @param void
+ * @return void
+ */
+void PgAuditLogToFile_close_barrier_leave(void)
+{
+  if (pgaudit_ltf_barrier_slot == NULL)
+    return;
+
+  if (pgaudit_ltf_file_handler != -1)
+    pg_atomic_write_u64(&pgaudit_ltf_barrier_slot->last_write, (uint64)time(NULL));
+
+  PgAuditLogToFile_close_barrier_absorb();
+}
+
+/**
+ * @brief Takes note of a close request, the file is closed at the next safe point (Async-Signal-Safe)
+ * @param void
+ * @return void
+ */
+void PgAuditLogToFile_close_barrier_signaled(void)
+{
+  pgaudit_ltf_barrier_signaled = true;
+}
+
+/**
+ * @brief Transaction callback - closes the audit file at the end of the transaction if the worker asked for it
+ * @param event: transaction event
+ * @param arg: unused
+ * @return void
+ */
+void PgAuditLogToFile_close_barrier_XactCallback(XactEvent event, void *arg)
+{
+  if (event != XACT_EVENT_COMMIT && event != XACT_EVENT_ABORT && event != XACT_EVENT_PREPARE)
+    return;
+
+  if (pgaudit_ltf_barrier_signaled)
+    PgAuditLogToFile_close_barrier_absorb();
+}
+
+/**
+ * @brief Closes the audit file if the worker asked for it, or if a rotation retired it, and acknowledges
+ * @param void
+ * @return void
+ */
+void PgAuditLogToFile_close_barrier_absorb(void)
+{
+  PgAuditLogToFileBackend *slot = pgaudit_ltf_barrier_slot;
+  uint64 generation;
+
+  /* a request arriving from now on is seen by this check or by the next one */
+  pgaudit_ltf_barrier_signaled = false;
+  pg_memory_barrier();
+
+  if (slot == NULL)
+    return;
+
+  generation = pg_atomic_read_u64(&pgaudit_ltf_shm->close_generation);
+  if (pg_atomic_read_u64(&slot->close_ack) >= generation &&
+      (pg_atomic_read_u32(&slot->fd_open) == 0 ||
+       (pg_atomic_read_u32(&slot->idle_close) == 0 && !pgauditlogtofile_close_barrier_stale(slot))))
+    return;
+
+  if (pgaudit_ltf_file_handler != -1)
+  {
+    close(pgaudit_ltf_file_handler);
+    pgaudit_ltf_file_handler = -1;
+  }
+  pg_atomic_write_u32(&slot->fd_open, 0);
+  pg_atomic_write_u32(&slot->idle_close, 0);
+  pg_write_barrier();
+  pg_atomic_write_u64(&slot->close_ack, generation);
+
+  pgauditlogtofile_close_barrier_wakeup();
+}
+
+/**
+ * @brief Asks every backend holding the audit file open to close it
+ * @param void
+ * @return uint64 - generation to wait for with PgAuditLogToFile_close_barrier_pending
+ */
+uint64 PgAuditLogToFile_close_barrier_emit(void)
+{
+  uint64 generation;
+  int i;
+
+  generation = pg_atomic_add_fetch_u64(&pgaudit_ltf_shm->close_generation, 1);
+
+  for (i = 0; i < pgaudit_ltf_shm->num_backends; i++)
+  {
+    PgAuditLogToFileBackend *slot = &pgaudit_ltf_shm->backends[i].slot;
+    int pid;
+
+    if (pg_atomic_read_u32(&slot->fd_open) == 0 || pg_atomic_read_u64(&slot->close_ack) >= generation)
+      continue;
+
+    /* a stale pid can only hit a new backend, which absorbs the barrier or ignores the signal */
+    pid = ProcGlobal->allProcs[i].pid;
+    if (pid != 0 && pid != MyProcPid)
+      pgauditlogtofile_close_barrier_signal(i, pid);
+  }
+
+  return generation;
+}
+
+/**
+ * @brief Counts the backends that still hold the audit file open since before the barrier
+ * @param generation: generation returned by PgAuditLogToFile_close_barrier_emit
+ * @return int - number of backends, 0 when the barrier is complete
+ */
+int PgAuditLogToFile_close_barrier_pending(uint64 generation)
+{
+  int pending = 0;
+  int i;
+
+  for (i = 0; i < pgaudit_ltf_shm->num_backends; i++)
+  {
+    PgAuditLogToFileBackend *slot = &pgaudit_ltf_shm->backends[i].slot;
+
+    if (pg_atomic_read_u32(&slot->fd_open) == 0 || pg_atomic_read_u64(&slot->close_ack) >= generation)
+      continue;
+
+    /* the backend exited without releasing the slot */
+    if (ProcGlobal->allProcs[i].pid == 0)
+      continue;
+
+    pending++;
+  }
+
+  return pending;
+}
+
+/**
+ * @brief Counts the backends that may hold open a file of the given rotation generation, or an older one
+ * @param generation: rotation generation of the file
+ * @param nudge: ask them to close it
+ * @return int - number of backends
+ */
+int PgAuditLogToFile_close_barrier_holders(uint32 generation, bool nudge)
+{
+  int holders = 0;
+  int i;
+
+  for (i = 0; i < pgaudit_ltf_shm->num_backends; i++)
+  {
+    PgAuditLogToFileBackend *slot = &pgaudit_ltf_shm->backends[i].slot;
+    int pid;
+
+    if (pg_atomic_read_u32(&slot->fd_open) == 0)
+      continue;
+
+    /* wraparound-aware, registered generations are never newer than the file */
+    if ((int32)(pg_atomic_read_u32(&slot->open_generation) - generation) > 0)
+      continue;
+
+    pid = ProcGlobal->allProcs[i].pid;
+    if (pid == 0)
+      continue;
+
+    holders++;
+    if (nudge && pid != MyProcPid)
+      pgauditlogtofile_close_barrier_signal(i, pid);
+  }
+
+  return holders;
+}
+
+/**
+ * @brief Asks the backends that didn't write an audit record for a while to close the audit file
+ * @param idle_secs: seconds without records
+ * @return long - milliseconds until the next backend can become idle
+ */
+long PgAuditLogToFile_close_barrier_idle(int idle_secs)
+{
+  pg_time_t now = (pg_time_t)time(NULL);
+  pg_time_t next_idle = now + idle_secs;
+  int i;
+
+  for (i = 0; i < pgaudit_ltf_shm->num_backends; i++)
+  {
+    PgAuditLogToFileBackend *slot = &pgaudit_ltf_shm->backends[i].slot;
+    pg_time_t idle_at;
+    int pid;
+
+    if (pg_atomic_read_u32(&slot->fd_open) == 0 || pg_atomic_read_u32(&slot->idle_close) != 0)
+      continue;
+
+    pid = ProcGlobal->allProcs[i].pid;
+    if (pid == 0)
+      continue;
+
+    idle_at = (pg_time_t)pg_atomic_read_u64(&slot->last_write) + idle_secs;
+    if (idle_at > now)
+    {
+      next_idle = Min(next_idle, idle_at);
+      continue;
+    }
+
+    /* the backend closes it at its next safe point */
+    pg_atomic_write_u32(&slot->idle_close, 1);
+    pg_memory_barrier();
+    if (pid != MyProcPid)
+      pgauditlogtofile_close_barrier_signal(i, pid);
+  }
+
+  return (long)(next_idle - now) * 1000L;
+}
+
+/* private functions */
+
+/**
+ * @brief Releases the slot at backend exit, later records use the file without the barrier
+ * @param code: exit code
+ * @param arg: not used
+ * @return void
+ */
+static void
+pgauditlogtofile_close_barrier_release(int code, Datum arg)
+{
+  PgAuditLogToFile_close_barrier_closed();
+
+  pgaudit_ltf_barrier_slot = NULL;
+  pgaudit_ltf_barrier_released = true;
+}
+
+/**
+ * @brief Checks if the file registered in the slot was retired by a rotation
+ * @param slot: backend slot
+ * @return bool - true if the rotation generation moved on
+ */
+static bool
+pgauditlogtofile_close_barrier_stale(const PgAuditLogToFileBackend *slot)
+{
+  return pg_atomic_read_u32((pg_atomic_uint32 *)&slot->open_generation) !=
+         pg_atomic_read_u32(&pgaudit_ltf_shm->rotation_generation);
+}
+
+/**
+ * @brief Signals a backend to close the audit file
+ * @param procno: backend slot
+ * @param pid: backend pid
+ * @return void
+ * @note The catchup interrupt makes an idle backend run a transaction, the callback closes the file
+ */
+static void
+pgauditlogtofile_close_barrier_signal(int procno, int pid)
+{
+#if (PG_VERSION_NUM >= 170000)
+  if (SendProcSignal(pid, PROCSIG_CATCHUP_INTERRUPT, (ProcNumber)procno) == 0)
+    return;
+#else
+  /* no backend id for background workers, the slot is searched by pid */
+  if (SendProcSignal(pid, PROCSIG_CATCHUP_INTERRUPT, InvalidBackendId) == 0)
+    return;
+#endif
+
+  /* processes without a procsignal slot close it at their next record */
+  kill(pid, SIGUSR1);
+}
+
+/**
+ * @brief Wakes up the worker
+ * @param void
+ * @return void
+ */
+static void
+pgauditlogtofile_close_barrier_wakeup(void)
+{
+  Latch *worker_latch = pgaudit_ltf_shm->worker_latch;
+
+  if (worker_latch != NULL)
+    SetLatch(worker_latch);
+}
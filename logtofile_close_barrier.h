@@ -0,0 +1,33 @@
+/*-------------------------------------------------------------------------
+ *
+ * logtofile_close_barrier.h
+ *      Barrier to make the backends close their audit file descriptor
+ *
+ * Copyright (c) 2026, Francisco Miguel Biete Banon
+ *
+ * This code is released under the PostgreSQL licence, as given at
+ *  http://www.postgresql.org/about/licence/
+ *-------------------------------------------------------------------------
+ */
+#ifndef _LOGTOFILE_CLOSE_BARRIER_H_
+#define _LOGTOFILE_CLOSE_BARRIER_H_
+
+#include <postgres.h>
+#include <access/xact.h>
+
+/* Backends */
+extern void PgAuditLogToFile_close_barrier_opening(uint32 generation);
+extern void PgAuditLogToFile_close_barrier_closed(void);
+extern void PgAuditLogToFile_close_barrier_enter(void);
+extern void PgAuditLogToFile_close_barrier_leave(void);
+extern void PgAuditLogToFile_close_barrier_absorb(void);
+extern void PgAuditLogToFile_close_barrier_signaled(void);
+extern void PgAuditLogToFile_close_barrier_XactCallback(XactEvent event, void *arg);
+
+/* Background worker */
+extern uint64 PgAuditLogToFile_close_barrier_emit(void);
+extern int PgAuditLogToFile_close_barrier_pending(uint64 generation);
+extern int PgAuditLogToFile_close_barrier_holders(uint32 generation, bool nudge);
+extern long PgAuditLogToFile_close_barrier_idle(int idle_secs);
+
+#endif
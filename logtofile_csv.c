@@ -11,6 +11,7 @@
  */
 #include "logtofile_csv.h"
 
+#include "logtofile_execution_jit.h"
 #include "logtofile_string_format.h"
 #include "logtofile_vars.h"
 
@@ -27,15 +28,19 @@
 
 /* forward declaration private functions */
 static void pgauditlogtofile_pgaudit2csv(StringInfo buf, char *line);
+static void pgauditlogtofile_csv_quote(StringInfo buf, const char *value);
 
 /**
  * @brief Creates a csv audit record
  * @param buf: buffer to write the csv line
  * @param edata: error data
  * @param exclude_nchars: number of characters to exclude from the pgaudit message
+ * @param pending: executor level with the statement stats, NULL if there are none
+ * @param sequence: global sequence number of the record
  * @return void
  */
-void PgAuditLogToFile_csv_audit(StringInfo buf, const ErrorData *edata, int exclude_nchars)
+void PgAuditLogToFile_csv_audit(StringInfo buf, const ErrorData *edata, int exclude_nchars,
+                                const PendingAudit *pending, uint64 sequence)
 {
   char formatted_log_time[FORMATTED_TS_LEN];
   const char *psdisp;
@@ -43,7 +48,6 @@ void PgAuditLogToFile_csv_audit(StringInfo buf, const ErrorData *edata, int excl
   instr_time now_instr;
   double total_time;
   instr_time duration;
-  Size memory_usage;
 
   /* timestamp with nanoseconds */
   INSTR_TIME_SET_CURRENT(now_instr);
@@ -175,30 +179,26 @@ void PgAuditLogToFile_csv_audit(StringInfo buf, const ErrorData *edata, int excl
   appendStringInfoCharMacro(buf, ',');
 
   /* execution time */
-  if (guc_pgaudit_ltf_log_execution_time &&
-      !INSTR_TIME_IS_ZERO(pgaudit_ltf_statement_start_time) &&
-      !INSTR_TIME_IS_ZERO(pgaudit_ltf_statement_end_time))
+  if (guc_pgaudit_ltf_log_execution_time && pending != NULL &&
+      !INSTR_TIME_IS_ZERO(pending->start_time) &&
+      !INSTR_TIME_IS_ZERO(pending->end_time))
   {
     /* start time */
-    PgAuditLogToFile_format_instr_time_nanos(pgaudit_ltf_statement_start_time, formatted_log_time, sizeof(formatted_log_time));
+    PgAuditLogToFile_format_instr_time_nanos(pending->start_time, formatted_log_time, sizeof(formatted_log_time));
     escape_json(buf, formatted_log_time);
     appendStringInfoCharMacro(buf, ',');
 
     /* end time */
-    PgAuditLogToFile_format_instr_time_nanos(pgaudit_ltf_statement_end_time, formatted_log_time, sizeof(formatted_log_time));
+    PgAuditLogToFile_format_instr_time_nanos(pending->end_time, formatted_log_time, sizeof(formatted_log_time));
     escape_json(buf, formatted_log_time);
     appendStringInfoCharMacro(buf, ',');
 
     /* execution time */
-    duration = pgaudit_ltf_statement_end_time;
-    INSTR_TIME_SUBTRACT(duration, pgaudit_ltf_statement_start_time);
+    duration = pending->end_time;
+    INSTR_TIME_SUBTRACT(duration, pending->start_time);
     total_time = INSTR_TIME_GET_DOUBLE(duration);
     appendStringInfo(buf, "\"%.9f\"", total_time);
     appendStringInfoCharMacro(buf, ',');
-
-    /* Reset timing variables after logging */
-    INSTR_TIME_SET_ZERO(pgaudit_ltf_statement_start_time);
-    INSTR_TIME_SET_ZERO(pgaudit_ltf_statement_end_time);
   }
   else
   {
@@ -206,31 +206,130 @@ void PgAuditLogToFile_csv_audit(StringInfo buf, const ErrorData *edata, int excl
   }
 
   /* memory usage */
-  if (guc_pgaudit_ltf_log_execution_memory &&
-      pgaudit_ltf_statement_memory_start > 0 &&
-      pgaudit_ltf_statement_memory_end > 0)
+  if (guc_pgaudit_ltf_log_execution_memory && pending != NULL &&
+      pending->memory_start > 0 &&
+      pending->memory_end > 0)
   {
-    memory_usage = pgaudit_ltf_statement_memory_end - pgaudit_ltf_statement_memory_start;
     appendStringInfo(buf, "\"%ld\",\"%ld\",\"%ld\",\"%ld\"",
-                     (long)pgaudit_ltf_statement_memory_start,
-                     (long)pgaudit_ltf_statement_memory_end,
-                     (long)pgaudit_ltf_statement_memory_peak,
-                     (long)(memory_usage < 0 ? 0 : memory_usage));
-
-    /* Reset memory variables */
-    pgaudit_ltf_statement_memory_start = 0;
-    pgaudit_ltf_statement_memory_end = 0;
+                     (long)pending->memory_start,
+                     (long)pending->memory_end,
+                     (long)pending->memory_peak,
+                     (long)(pending->memory_end > pending->memory_start ? pending->memory_end - pending->memory_start : 0));
   }
   else
   {
     appendStringInfo(buf, ",,,");
   }
+  appendStringInfoCharMacro(buf, ',');
+
+  /* buffer, temporary file and WAL usage */
+  if (guc_pgaudit_ltf_log_execution_buffers && pending != NULL && pending->buffers_measured)
+  {
+    appendStringInfo(buf, "\"" INT64_FORMAT "\",", pending->buffers.shared_blks_hit);
+    appendStringInfo(buf, "\"" INT64_FORMAT "\",", pending->buffers.shared_blks_read);
+    appendStringInfo(buf, "\"" INT64_FORMAT "\",", pending->buffers.shared_blks_dirtied);
+    appendStringInfo(buf, "\"" INT64_FORMAT "\",", pending->buffers.shared_blks_written);
+    appendStringInfo(buf, "\"" INT64_FORMAT "\",", pending->buffers.local_blks_hit);
+    appendStringInfo(buf, "\"" INT64_FORMAT "\",", pending->buffers.local_blks_read);
+    appendStringInfo(buf, "\"" INT64_FORMAT "\",", pending->buffers.local_blks_dirtied);
+    appendStringInfo(buf, "\"" INT64_FORMAT "\",", pending->buffers.local_blks_written);
+    appendStringInfo(buf, "\"" INT64_FORMAT "\",", pending->buffers.temp_blks_read);
+    appendStringInfo(buf, "\"" INT64_FORMAT "\",", pending->buffers.temp_blks_written);
+    appendStringInfo(buf, "\"" INT64_FORMAT "\",", pending->wal.wal_records);
+    appendStringInfo(buf, "\"" INT64_FORMAT "\",", pending->wal.wal_fpi);
+    appendStringInfo(buf, "\"" UINT64_FORMAT "\"", pending->wal.wal_bytes);
+  }
+  else
+  {
+    appendStringInfo(buf, ",,,,,,,,,,,,");
+  }
+  appendStringInfoCharMacro(buf, ',');
+
+  /* JIT compilation */
+  if (guc_pgaudit_ltf_log_execution_jit && pending != NULL && pending->jit_measured)
+  {
+    appendStringInfo(buf, "\"%zu\",\"%.9f\"", pending->jit.created_functions,
+                     PgAuditLogToFile_jit_total_time(&pending->jit));
+  }
+  else
+  {
+    appendStringInfoCharMacro(buf, ',');
+  }
+  appendStringInfoCharMacro(buf, ',');
+
+  /* OS resource usage */
+  if (guc_pgaudit_ltf_log_execution_rusage && pending != NULL && pending->rusage_measured)
+  {
+    appendStringInfo(buf, "\"%.6f\",\"%.6f\",\"%ld\",\"%ld\",",
+                     pending->rusage_user_time,
+                     pending->rusage_system_time,
+                     pending->rusage_nvcsw,
+                     pending->rusage_nivcsw);
+  }
+  else
+  {
+    appendStringInfo(buf, ",,,,");
+  }
+
+  if (guc_pgaudit_ltf_log_execution_rusage && pending != NULL && pending->io_measured)
+  {
+    appendStringInfo(buf, "\"" UINT64_FORMAT "\",\"" UINT64_FORMAT "\"",
+                     pending->io_read_bytes,
+                     pending->io_write_bytes);
+  }
+  else
+  {
+    appendStringInfoCharMacro(buf, ',');
+  }
+  appendStringInfoCharMacro(buf, ',');
+
+  /* parallel workers, leader plus workers totals */
+  if (guc_pgaudit_ltf_log_execution_parallel && pending != NULL && pending->parallel_measured)
+  {
+    appendStringInfo(buf, "\"" UINT64_FORMAT "\",\"%ld\",\"%.6f\"",
+                     pending->parallel_workers,
+                     (long)pending->parallel_memory_peak,
+                     pending->parallel_cpu_time);
+  }
+  else
+  {
+    appendStringInfo(buf, ",,");
+  }
+  appendStringInfoCharMacro(buf, ',');
+
+  /* plan of slow statements, its quotes doubled so it reads back as the JSON document */
+  if (pending != NULL && pending->plan != NULL)
+    pgauditlogtofile_csv_quote(buf, pending->plan);
+  appendStringInfoCharMacro(buf, ',');
+
+  /* sequence number, last so the previous columns keep their position */
+  appendStringInfo(buf, "\"" UINT64_FORMAT "\"", sequence);
 
   appendStringInfoCharMacro(buf, '\n');
 }
 
 /* private functions */
 
+/**
+ * @brief Writes a value as a quoted CSV field, doubling its quotes
+ * @param buf Where to write
+ * @param value value to write, without newlines (the plan is compact JSON)
+ */
+static void
+pgauditlogtofile_csv_quote(StringInfo buf, const char *value)
+{
+  const char *p;
+
+  appendStringInfoCharMacro(buf, '"');
+  for (p = value; *p != '\0'; p++)
+  {
+    if (*p == '"')
+      appendStringInfoCharMacro(buf, '"');
+    appendStringInfoCharMacro(buf, *p);
+  }
+  appendStringInfoCharMacro(buf, '"');
+}
+
 /**
  * @brief Split and escapes each piece on pgaudit original message and writes it as CSV value.
  * @param buf Where to write
@@ -15,6 +15,9 @@
 #include <postgres.h>
 #include <lib/stringinfo.h>
 
-extern void PgAuditLogToFile_csv_audit(StringInfo buf, const ErrorData *edata, int exclude_nchars);
+#include "logtofile_vars.h"
+
+extern void PgAuditLogToFile_csv_audit(StringInfo buf, const ErrorData *edata, int exclude_nchars,
+                                       const PendingAudit *pending, uint64 sequence);
 
 #endif
@@ -15,7 +15,6 @@
 #include <postgres.h>
 #include <utils/elog.h>
 
-extern void PgAuditLogToFile_CopyPendingErrorData(ErrorData *edata);
-extern void PgAuditLogToFile_FreePendingErrorData(void);
+extern ErrorData *PgAuditLogToFile_CopyErrorData(ErrorData *edata, MemoryContext context);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,47 @@
+/*-------------------------------------------------------------------------
+ *
+ * logtofile_execution_buffers.c
+ *      Partial hooks to measure buffer and WAL usage of execution
+ *
+ * Copyright (c) 2026, Francisco Miguel Biete Banon
+ *
+ * This code is released under the PostgreSQL licence, as given at
+ *  http://www.postgresql.org/about/licence/
+ *-------------------------------------------------------------------------
+ */
+#include "logtofile_execution_buffers.h"
+
+#include "logtofile_vars.h"
+
+#include <executor/instrument.h>
+
+/**
+ * @brief ExecutorStart hook to record the buffer and WAL counters at the start of a statement.
+ * @param pending executor level of the statement
+ * @param queryDesc
+ * @param eflags
+ */
+void PgAuditLogToFile_ExecutorStart_Buffers(PendingAudit *pending, __attribute__((unused)) QueryDesc *queryDesc,
+                                            __attribute__((unused)) int eflags)
+{
+  pending->buffers_start = pgBufferUsage;
+  pending->wal_start = pgWalUsage;
+  pending->buffers_measured = false;
+}
+
+/**
+ * @brief ExecutorEnd hook to calculate the buffer and WAL usage of the statement.
+ * @param pending executor level of the statement
+ * @param queryDesc
+ * @note Parallel workers usage is already accumulated in the leader counters when the Gather finishes.
+ */
+void PgAuditLogToFile_ExecutorEnd_Buffers(PendingAudit *pending, __attribute__((unused)) QueryDesc *queryDesc)
+{
+  memset(&pending->buffers, 0, sizeof(BufferUsage));
+  BufferUsageAccumDiff(&pending->buffers, &pgBufferUsage, &pending->buffers_start);
+
+  memset(&pending->wal, 0, sizeof(WalUsage));
+  WalUsageAccumDiff(&pending->wal, &pgWalUsage, &pending->wal_start);
+
+  pending->buffers_measured = true;
+}
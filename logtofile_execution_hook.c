@@ -11,9 +11,16 @@
  */
 #include "logtofile_execution_hook.h"
 
+#include "logtofile_execution_buffers.h"
+#include "logtofile_execution_jit.h"
 #include "logtofile_execution_memory.h"
+#include "logtofile_execution_parallel.h"
+#include "logtofile_execution_plan.h"
+#include "logtofile_execution_rusage.h"
 #include "logtofile_execution_time.h"
+#include "logtofile_pending.h"
 #include "logtofile_vars.h"
+#include "logtofile_wait_event.h"
 #include "logtofile_signal_handler.h"
 #include "logtofile_log.h"
 
@@ -30,17 +37,22 @@ static bool pgaudit_ltf_handler_setup = false;
  */
 void PgAuditLogToFile_ExecutorStart_Hook(QueryDesc *queryDesc, int eflags)
 {
+  PendingAudit *pending;
+
   if (!pgaudit_ltf_handler_setup)
   {
-#if (PG_VERSION_NUM >= 180000)
-    /* setup a signal handler for SIGUSR1 in the backend, and hope we don't lose another */
-    /* we will always call the default postgresql signal handler */
-    pqsignal(SIGUSR1, PgAuditLogToFile_SIGUSR1);
-#else
-    /* setup a signal handler for SIGUSR1 in the backend, and save the existing */
-    pgaudit_ltf_prev_sigusr1_handler = pqsignal(SIGUSR1, PgAuditLogToFile_SIGUSR1);
-#endif
+    PgAuditLogToFile_SIGUSR1_setup();
     pgaudit_ltf_handler_setup = true; /* only once */
+
+    /* safe place to register them, unlike emit_log */
+    PgAuditLogToFile_wait_events_init();
+  }
+
+  /* new executor level before pgaudit emits the records of this statement */
+  if (PgAuditLogToFile_Pending_Enabled())
+  {
+    PgAuditLogToFile_Pending_Push(queryDesc);
+    PgAuditLogToFile_ExecutorStart_Plan(queryDesc, eflags);
   }
 
   if (pgaudit_ltf_prev_ExecutorStart)
@@ -48,10 +60,24 @@ void PgAuditLogToFile_ExecutorStart_Hook(QueryDesc *queryDesc, int eflags)
   else
     standard_ExecutorStart(queryDesc, eflags);
 
-  if (guc_pgaudit_ltf_log_execution_time)
-    PgAuditLogToFile_ExecutorStart_Time(queryDesc, eflags);
-  if (guc_pgaudit_ltf_log_execution_memory)
-    PgAuditLogToFile_ExecutorStart_Memory(queryDesc, eflags);
+  /* search again, the stack can be reallocated by nested statements */
+  pending = PgAuditLogToFile_Pending_Find(queryDesc);
+  if (pending != NULL)
+  {
+    /* the plan capture depends on the duration */
+    if (guc_pgaudit_ltf_log_execution_time || guc_pgaudit_ltf_log_execution_plan_min_duration >= 0)
+      PgAuditLogToFile_ExecutorStart_Time(pending, queryDesc, eflags);
+    /* parallel totals are built from the memory and CPU of every process */
+    if (guc_pgaudit_ltf_log_execution_memory || guc_pgaudit_ltf_log_execution_parallel)
+      PgAuditLogToFile_ExecutorStart_Memory(pending, queryDesc, eflags);
+    if (guc_pgaudit_ltf_log_execution_buffers)
+      PgAuditLogToFile_ExecutorStart_Buffers(pending, queryDesc, eflags);
+    if (guc_pgaudit_ltf_log_execution_rusage || guc_pgaudit_ltf_log_execution_parallel)
+      PgAuditLogToFile_ExecutorStart_Rusage(pending, queryDesc, eflags);
+    if (guc_pgaudit_ltf_log_execution_parallel)
+      PgAuditLogToFile_ExecutorStart_Parallel(pending, queryDesc, eflags);
+    pending->running = true;
+  }
 }
 
 /**
@@ -60,25 +86,33 @@ void PgAuditLogToFile_ExecutorStart_Hook(QueryDesc *queryDesc, int eflags)
  */
 void PgAuditLogToFile_ExecutorEnd_Hook(QueryDesc *queryDesc)
 {
-  if (guc_pgaudit_ltf_log_execution_time)
-    PgAuditLogToFile_ExecutorEnd_Time(queryDesc);
-  if (guc_pgaudit_ltf_log_execution_memory)
-    PgAuditLogToFile_ExecutorEnd_Memory(queryDesc);
+  PendingAudit *pending = PgAuditLogToFile_Pending_Find(queryDesc);
 
-  /* Flush buffered audit records now that we have the stats */
-  PgAuditLogToFile_Flush_Pending();
-
-  /* Reset timing and memory variables to 0 so unrelated logs (like disconnection) don't use them */
-  if (guc_pgaudit_ltf_log_execution_time)
-  {
-    INSTR_TIME_SET_ZERO(pgaudit_ltf_statement_start_time);
-    INSTR_TIME_SET_ZERO(pgaudit_ltf_statement_end_time);
-  }
-  if (guc_pgaudit_ltf_log_execution_memory)
+  if (pending != NULL)
   {
-    pgaudit_ltf_statement_memory_start = 0;
-    pgaudit_ltf_statement_memory_end = 0;
-    pgaudit_ltf_statement_memory_peak = 0;
+    /* workers must be done before their usage is added to the leader, only needed if we report it */
+    if (guc_pgaudit_ltf_log_execution_parallel || guc_pgaudit_ltf_log_execution_buffers ||
+        guc_pgaudit_ltf_log_execution_jit ||
+        (guc_pgaudit_ltf_log_execution_plan_min_duration >= 0 && guc_pgaudit_ltf_log_execution_plan_analyze))
+      PgAuditLogToFile_ExecutorShutdown_Parallel(pending, queryDesc);
+
+    if (guc_pgaudit_ltf_log_execution_time || guc_pgaudit_ltf_log_execution_plan_min_duration >= 0)
+      PgAuditLogToFile_ExecutorEnd_Time(pending, queryDesc);
+    if (guc_pgaudit_ltf_log_execution_memory || guc_pgaudit_ltf_log_execution_parallel)
+      PgAuditLogToFile_ExecutorEnd_Memory(pending, queryDesc);
+    if (guc_pgaudit_ltf_log_execution_buffers)
+      PgAuditLogToFile_ExecutorEnd_Buffers(pending, queryDesc);
+    if (guc_pgaudit_ltf_log_execution_jit)
+      PgAuditLogToFile_ExecutorEnd_Jit(pending, queryDesc);
+    if (guc_pgaudit_ltf_log_execution_rusage || guc_pgaudit_ltf_log_execution_parallel)
+      PgAuditLogToFile_ExecutorEnd_Rusage(pending, queryDesc);
+    if (guc_pgaudit_ltf_log_execution_parallel)
+      PgAuditLogToFile_ExecutorEnd_Parallel(pending, queryDesc);
+    if (guc_pgaudit_ltf_log_execution_plan_min_duration >= 0)
+      PgAuditLogToFile_ExecutorEnd_Plan(pending, queryDesc);
+
+    /* Flush buffered audit records now that we have the stats */
+    PgAuditLogToFile_Pending_Pop(pending);
   }
 
   if (pgaudit_ltf_prev_ExecutorEnd)
@@ -102,14 +136,19 @@ void PgAuditLogToFile_ExecutorRun_Hook(QueryDesc *queryDesc, ScanDirection direc
 void PgAuditLogToFile_ExecutorRun_Hook(QueryDesc *queryDesc, ScanDirection direction, uint64 count, bool execute_once)
 #endif
 {
-  if (guc_pgaudit_ltf_log_execution_memory)
-    PgAuditLogToFile_ExecutorRun_Memory(EX_RUN_ARGS);
+  PendingAudit *pending;
+
+  if ((guc_pgaudit_ltf_log_execution_memory || guc_pgaudit_ltf_log_execution_parallel) &&
+      (pending = PgAuditLogToFile_Pending_Find(queryDesc)) != NULL)
+    PgAuditLogToFile_ExecutorRun_Memory(pending, EX_RUN_ARGS);
 
   if (pgaudit_ltf_prev_ExecutorRun)
     pgaudit_ltf_prev_ExecutorRun(EX_RUN_ARGS);
   else
     standard_ExecutorRun(EX_RUN_ARGS);
 
-  if (guc_pgaudit_ltf_log_execution_memory)
-    PgAuditLogToFile_ExecutorRun_Memory(EX_RUN_ARGS);
+  /* nested statements may have moved the level */
+  if ((guc_pgaudit_ltf_log_execution_memory || guc_pgaudit_ltf_log_execution_parallel) &&
+      (pending = PgAuditLogToFile_Pending_Find(queryDesc)) != NULL)
+    PgAuditLogToFile_ExecutorRun_Memory(pending, EX_RUN_ARGS);
 }
\ No newline at end of file
@@ -0,0 +1,56 @@
+/*-------------------------------------------------------------------------
+ *
+ * logtofile_execution_jit.c
+ *      Partial hooks to measure JIT compilation of execution
+ *
+ * Copyright (c) 2026, Francisco Miguel Biete Banon
+ *
+ * This code is released under the PostgreSQL licence, as given at
+ *  http://www.postgresql.org/about/licence/
+ *-------------------------------------------------------------------------
+ */
+#include "logtofile_execution_jit.h"
+
+#include "logtofile_vars.h"
+
+#include <jit/jit.h>
+
+/**
+ * @brief ExecutorEnd hook to collect the JIT instrumentation of the statement, leader and workers.
+ * @param pending executor level of the statement
+ * @param queryDesc
+ * @note Must run before standard_ExecutorEnd releases the JIT context.
+ */
+void PgAuditLogToFile_ExecutorEnd_Jit(PendingAudit *pending, QueryDesc *queryDesc)
+{
+  EState *estate = queryDesc->estate;
+
+  memset(&pending->jit, 0, sizeof(JitInstrumentation));
+
+  if (estate != NULL)
+  {
+    if (estate->es_jit != NULL)
+      InstrJitAgg(&pending->jit, &estate->es_jit->instr);
+
+    if (estate->es_jit_worker_instr != NULL)
+      InstrJitAgg(&pending->jit, estate->es_jit_worker_instr);
+  }
+
+  pending->jit_measured = true;
+}
+
+/**
+ * @brief Total time spent in JIT compilation
+ * @param jit JIT instrumentation
+ * @return double - seconds
+ */
+double PgAuditLogToFile_jit_total_time(const JitInstrumentation *jit)
+{
+  instr_time total = jit->generation_counter;
+
+  INSTR_TIME_ADD(total, jit->inlining_counter);
+  INSTR_TIME_ADD(total, jit->optimization_counter);
+  INSTR_TIME_ADD(total, jit->emission_counter);
+
+  return INSTR_TIME_GET_DOUBLE(total);
+}
@@ -0,0 +1,23 @@
+/*-------------------------------------------------------------------------
+ *
+ * logtofile_execution_jit.h
+ *      Partial hooks to measure JIT compilation of execution
+ *
+ * Copyright (c) 2026, Francisco Miguel Biete Banon
+ *
+ * This code is released under the PostgreSQL licence, as given at
+ *  http://www.postgresql.org/about/licence/
+ *-------------------------------------------------------------------------
+ */
+#ifndef _LOGTOFILE_EXECUTION_JIT_H_
+#define _LOGTOFILE_EXECUTION_JIT_H_
+
+#include <postgres.h>
+#include <executor/executor.h>
+
+#include "logtofile_vars.h"
+
+extern void PgAuditLogToFile_ExecutorEnd_Jit(PendingAudit *pending, QueryDesc *queryDesc);
+extern double PgAuditLogToFile_jit_total_time(const JitInstrumentation *jit);
+
+#endif
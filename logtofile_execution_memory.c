@@ -13,49 +13,86 @@
 
 #include "logtofile_vars.h"
 
+#include <nodes/nodeFuncs.h>
+#include <utils/hsearch.h>
 #include <utils/memutils.h>
 
+/* Original ExecProcNode functions of a plan tree wrapped for memory sampling, by executor state */
+typedef struct PgAuditLogToFileSampledPlan
+{
+  EState *estate;          /* hash key */
+  ExecProcMtd *exec_procs; /* indexed by plan_node_id, in the query context */
+  EState *outer_estate;    /* plan active when this one started, restored at its end */
+} PgAuditLogToFileSampledPlan;
+
+/* variables to use only in this unit */
+static HTAB *pgaudit_ltf_sampled_plans = NULL;
+/* one entry cache of the plan running now, the hash is only searched for nested executors */
+static PgAuditLogToFileSampledPlan *pgaudit_ltf_active_plan = NULL;
+static int pgaudit_ltf_memory_sample_counter = 0;
+
 /* forward declaration private functions */
+static void pgauditlogtofile_sample_plan(QueryDesc *queryDesc);
+static bool pgauditlogtofile_max_plan_node_id_walker(PlanState *planstate, void *context);
+static bool pgauditlogtofile_wrap_exec_proc_node_walker(PlanState *planstate, void *context);
+static TupleTableSlot *pgauditlogtofile_sampled_exec_proc_node(PlanState *node);
+static void pgauditlogtofile_sample_memory(EState *estate);
+static void pgauditlogtofile_sampled_plan_release(void *arg);
+static PgAuditLogToFileSampledPlan *pgauditlogtofile_sampled_plan_find(EState *estate);
 inline static Size pgauditlogtofile_MemoryContextTotalAllocated(MemoryContext ctx) __attribute__((always_inline));
 inline static MemoryContext pgauditlogtofile_get_query_memory_context(QueryDesc *queryDesc) __attribute__((always_inline));
-inline static void pgauditlogtofile_update_peak_memory(Size current) __attribute__((always_inline));
+inline static void pgauditlogtofile_update_peak_memory(PendingAudit *pending, Size current) __attribute__((always_inline));
 
 /**
  * @brief ExecutorStart hook to record the memory usage at the start of a statement.
+ * @param pending executor level of the statement
  * @param queryDesc
  * @param eflags
  */
-void PgAuditLogToFile_ExecutorStart_Memory(QueryDesc *queryDesc, __attribute__((unused)) int eflags)
+void PgAuditLogToFile_ExecutorStart_Memory(PendingAudit *pending, QueryDesc *queryDesc, __attribute__((unused)) int eflags)
 {
   MemoryContext ctx = pgauditlogtofile_get_query_memory_context(queryDesc);
 
-  pgaudit_ltf_statement_memory_start = pgauditlogtofile_MemoryContextTotalAllocated(ctx);
-  pgaudit_ltf_statement_memory_peak = pgaudit_ltf_statement_memory_start;
-  pgaudit_ltf_statement_memory_end = 0;
+  pending->memory_start = pgauditlogtofile_MemoryContextTotalAllocated(ctx);
+  pending->memory_peak = pending->memory_start;
+  pending->memory_end = 0;
+
+  /* sample during the run to catch peaks released before it ends (hash batches, sorts, rescans) */
+  if (guc_pgaudit_ltf_log_execution_memory_sample_interval > 0 && ctx != NULL && queryDesc->planstate != NULL)
+    pgauditlogtofile_sample_plan(queryDesc);
 }
 
 /**
  * @brief ExecutorEnd hook to calculate and log the statement memory usage.
+ * @param pending executor level of the statement
  * @param queryDesc
  */
-void PgAuditLogToFile_ExecutorEnd_Memory(QueryDesc *queryDesc)
+void PgAuditLogToFile_ExecutorEnd_Memory(PendingAudit *pending, QueryDesc *queryDesc)
 {
   MemoryContext ctx = pgauditlogtofile_get_query_memory_context(queryDesc);
 
-  pgaudit_ltf_statement_memory_end = pgauditlogtofile_MemoryContextTotalAllocated(ctx);
-  pgauditlogtofile_update_peak_memory(pgaudit_ltf_statement_memory_end);
+  pending->memory_end = pgauditlogtofile_MemoryContextTotalAllocated(ctx);
+  pgauditlogtofile_update_peak_memory(pending, pending->memory_end);
+
+  /* back to the executor that started this one */
+  if (pgaudit_ltf_active_plan != NULL && queryDesc->estate != NULL &&
+      pgaudit_ltf_active_plan->estate == queryDesc->estate)
+    pgaudit_ltf_active_plan = pgauditlogtofile_sampled_plan_find(pgaudit_ltf_active_plan->outer_estate);
 }
 
 /**
  * @brief ExecutorRun hook to capture peak of memory usage during run
+ * @param pending executor level of the statement
  * @param queryDesc
  */
 #if (PG_VERSION_NUM >= 180000)
-void PgAuditLogToFile_ExecutorRun_Memory(QueryDesc *queryDesc,
+void PgAuditLogToFile_ExecutorRun_Memory(PendingAudit *pending,
+                                         QueryDesc *queryDesc,
                                          __attribute__((unused)) ScanDirection direction,
                                          __attribute__((unused)) uint64 count)
 #else
-void PgAuditLogToFile_ExecutorRun_Memory(QueryDesc *queryDesc,
+void PgAuditLogToFile_ExecutorRun_Memory(PendingAudit *pending,
+                                         QueryDesc *queryDesc,
                                          __attribute__((unused)) ScanDirection direction,
                                          __attribute__((unused)) uint64 count,
                                          __attribute__((unused)) bool execute_once)
@@ -64,7 +101,17 @@ void PgAuditLogToFile_ExecutorRun_Memory(QueryDesc *queryDesc,
   MemoryContext ctx = pgauditlogtofile_get_query_memory_context(queryDesc);
   Size current = pgauditlogtofile_MemoryContextTotalAllocated(ctx);
 
-  pgauditlogtofile_update_peak_memory(current);
+  pgauditlogtofile_update_peak_memory(pending, current);
+
+  /* a cursor or a nested executor may have run in between */
+  if (queryDesc->estate != NULL &&
+      (pgaudit_ltf_active_plan == NULL || pgaudit_ltf_active_plan->estate != queryDesc->estate))
+  {
+    PgAuditLogToFileSampledPlan *plan = pgauditlogtofile_sampled_plan_find(queryDesc->estate);
+
+    if (plan != NULL)
+      pgaudit_ltf_active_plan = plan;
+  }
 }
 
 /* private functions */
@@ -94,13 +141,178 @@ pgauditlogtofile_get_query_memory_context(QueryDesc *queryDesc)
   return (queryDesc && queryDesc->estate) ? queryDesc->estate->es_query_cxt : NULL;
 }
 
+/**
+ * @brief Wraps the ExecProcNode function of every node in the plan tree to sample memory periodically
+ * @param queryDesc
+ */
+static void
+pgauditlogtofile_sample_plan(QueryDesc *queryDesc)
+{
+  EState *estate = queryDesc->estate;
+  PgAuditLogToFileSampledPlan *plan;
+  MemoryContextCallback *callback;
+  ExecProcMtd *exec_procs;
+  int max_plan_node_id = -1;
+  bool found;
+
+  pgauditlogtofile_max_plan_node_id_walker(queryDesc->planstate, &max_plan_node_id);
+  if (max_plan_node_id < 0)
+    return;
+
+  if (pgaudit_ltf_sampled_plans == NULL)
+  {
+    HASHCTL ctl;
+
+    ctl.keysize = sizeof(EState *);
+    ctl.entrysize = sizeof(PgAuditLogToFileSampledPlan);
+    pgaudit_ltf_sampled_plans = hash_create("pgauditlogtofile sampled plans", 8, &ctl, HASH_ELEM | HASH_BLOBS);
+  }
+
+  /* everything that can fail, before any node is wrapped */
+  exec_procs = (ExecProcMtd *)MemoryContextAllocZero(estate->es_query_cxt, sizeof(ExecProcMtd) * (max_plan_node_id + 1));
+  callback = (MemoryContextCallback *)MemoryContextAllocZero(estate->es_query_cxt, sizeof(MemoryContextCallback));
+  plan = (PgAuditLogToFileSampledPlan *)hash_search(pgaudit_ltf_sampled_plans, &estate, HASH_ENTER, &found);
+  plan->exec_procs = exec_procs;
+  plan->outer_estate = (pgaudit_ltf_active_plan != NULL) ? pgaudit_ltf_active_plan->estate : NULL;
+  pgaudit_ltf_active_plan = plan;
+
+  /* lives exactly as long as the plan nodes that reference it */
+  callback->func = pgauditlogtofile_sampled_plan_release;
+  callback->arg = estate;
+  MemoryContextRegisterResetCallback(estate->es_query_cxt, callback);
+
+  pgauditlogtofile_wrap_exec_proc_node_walker(queryDesc->planstate, plan);
+}
+
+/**
+ * @brief planstate walker to obtain the highest plan_node_id
+ * @param planstate
+ * @param context int * with the highest plan_node_id found
+ * @return bool
+ */
+static bool
+pgauditlogtofile_max_plan_node_id_walker(PlanState *planstate, void *context)
+{
+  int *max_plan_node_id = (int *)context;
+
+  if (planstate->plan->plan_node_id > *max_plan_node_id)
+    *max_plan_node_id = planstate->plan->plan_node_id;
+
+  return planstate_tree_walker(planstate, pgauditlogtofile_max_plan_node_id_walker, context);
+}
+
+/**
+ * @brief planstate walker to replace ExecProcNodeReal with the sampling wrapper
+ * @param planstate
+ * @param context PgAuditLogToFileSampledPlan * where the original functions are saved
+ * @return bool
+ */
+static bool
+pgauditlogtofile_wrap_exec_proc_node_walker(PlanState *planstate, void *context)
+{
+  PgAuditLogToFileSampledPlan *plan = (PgAuditLogToFileSampledPlan *)context;
+
+  /*
+   * ExecProcNodeFirst and ExecProcNodeInstr both call ExecProcNodeReal, so the
+   * wrapper is used with or without instrumentation.
+   */
+  if (planstate->ExecProcNodeReal != NULL)
+  {
+    plan->exec_procs[planstate->plan->plan_node_id] = planstate->ExecProcNodeReal;
+    planstate->ExecProcNodeReal = pgauditlogtofile_sampled_exec_proc_node;
+  }
+
+  return planstate_tree_walker(planstate, pgauditlogtofile_wrap_exec_proc_node_walker, context);
+}
+
+/**
+ * @brief ExecProcNode wrapper, samples the memory every N node executions
+ * @param node
+ * @return TupleTableSlot *
+ */
+static TupleTableSlot *
+pgauditlogtofile_sampled_exec_proc_node(PlanState *node)
+{
+  PgAuditLogToFileSampledPlan *plan = pgaudit_ltf_active_plan;
+
+  /* nodes of another executor, e.g. a function called by a node of this one */
+  if (unlikely(plan == NULL || plan->estate != node->state))
+  {
+    plan = pgauditlogtofile_sampled_plan_find(node->state);
+    if (plan == NULL)
+      elog(ERROR, "pgauditlogtofile could not find the sampled plan of node %d", node->plan->plan_node_id);
+    pgaudit_ltf_active_plan = plan;
+  }
+
+  if (guc_pgaudit_ltf_log_execution_memory_sample_interval > 0 &&
+      ++pgaudit_ltf_memory_sample_counter >= guc_pgaudit_ltf_log_execution_memory_sample_interval)
+  {
+    pgaudit_ltf_memory_sample_counter = 0;
+    pgauditlogtofile_sample_memory(node->state);
+  }
+
+  return plan->exec_procs[node->plan->plan_node_id](node);
+}
+
+/**
+ * @brief Updates the peak memory of the statement that owns an executor state
+ * @param estate
+ */
+static void
+pgauditlogtofile_sample_memory(EState *estate)
+{
+  int i;
+
+  for (i = pgaudit_ltf_pending_depth - 1; i >= 0; i--)
+  {
+    PendingAudit *pending = &pgaudit_ltf_pending_stack[i];
+
+    if (pending->query_desc != NULL && pending->query_desc->estate == estate)
+    {
+      pgauditlogtofile_update_peak_memory(pending, pgauditlogtofile_MemoryContextTotalAllocated(estate->es_query_cxt));
+      return;
+    }
+  }
+}
+
+/**
+ * @brief Reset callback of the query context, forgets the sampled plan
+ * @param arg EState * of the plan
+ */
+static void
+pgauditlogtofile_sampled_plan_release(void *arg)
+{
+  EState *estate = (EState *)arg;
+
+  /* the entry is gone, the next node finds the plan in the hash */
+  if (pgaudit_ltf_active_plan != NULL && pgaudit_ltf_active_plan->estate == estate)
+    pgaudit_ltf_active_plan = NULL;
+
+  (void)hash_search(pgaudit_ltf_sampled_plans, &estate, HASH_REMOVE, NULL);
+}
+
+/**
+ * @brief Finds the sampled plan of an executor state, it never allocates nor fails
+ * @param estate
+ * @return PgAuditLogToFileSampledPlan * - the plan, NULL if its nodes are not sampled
+ */
+static PgAuditLogToFileSampledPlan *
+pgauditlogtofile_sampled_plan_find(EState *estate)
+{
+  if (pgaudit_ltf_sampled_plans == NULL || estate == NULL)
+    return NULL;
+
+  return (PgAuditLogToFileSampledPlan *)hash_search(pgaudit_ltf_sampled_plans, &estate, HASH_FIND, NULL);
+}
+
 /**
  * @brief Update the peak memory value if required
+ * @param pending executor level of the statement
  * @param current
  */
 static void
-pgauditlogtofile_update_peak_memory(Size current)
+pgauditlogtofile_update_peak_memory(PendingAudit *pending, Size current)
 {
-  if (current > pgaudit_ltf_statement_memory_peak)
-    pgaudit_ltf_statement_memory_peak = current;
+  if (current > pending->memory_peak)
+    pending->memory_peak = current;
 }
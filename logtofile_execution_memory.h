@@ -15,12 +15,14 @@
 #include <postgres.h>
 #include <executor/executor.h>
 
-extern void PgAuditLogToFile_ExecutorStart_Memory(QueryDesc *queryDesc, int eflags);
-extern void PgAuditLogToFile_ExecutorEnd_Memory(QueryDesc *queryDesc);
+#include "logtofile_vars.h"
+
+extern void PgAuditLogToFile_ExecutorStart_Memory(PendingAudit *pending, QueryDesc *queryDesc, int eflags);
+extern void PgAuditLogToFile_ExecutorEnd_Memory(PendingAudit *pending, QueryDesc *queryDesc);
 #if (PG_VERSION_NUM >= 180000)
-extern void PgAuditLogToFile_ExecutorRun_Memory(QueryDesc *queryDesc, ScanDirection direction, uint64 count);
+extern void PgAuditLogToFile_ExecutorRun_Memory(PendingAudit *pending, QueryDesc *queryDesc, ScanDirection direction, uint64 count);
 #else
-extern void PgAuditLogToFile_ExecutorRun_Memory(QueryDesc *queryDesc, ScanDirection direction, uint64 count, bool execute_once);
+extern void PgAuditLogToFile_ExecutorRun_Memory(PendingAudit *pending, QueryDesc *queryDesc, ScanDirection direction, uint64 count, bool execute_once);
 #endif
 
 #endif
@@ -0,0 +1,112 @@
+/*-------------------------------------------------------------------------
+ *
+ * logtofile_execution_parallel.c
+ *      Partial hooks to aggregate the usage of parallel query workers
+ *
+ * Copyright (c) 2026, Francisco Miguel Biete Banon
+ *
+ * This code is released under the PostgreSQL licence, as given at
+ *  http://www.postgresql.org/about/licence/
+ *-------------------------------------------------------------------------
+ */
+#include "logtofile_execution_parallel.h"
+
+#include "logtofile_shmem.h"
+#include "logtofile_vars.h"
+
+#include <access/parallel.h>
+#include <storage/proc.h>
+
+/*
+ * Parallel workers run their own ExecutorStart/ExecutorEnd with their own
+ * executor level. At ExecutorEnd every worker adds its memory peak and CPU
+ * time to the shared slot of its leader, the leader reads the difference of
+ * the slot counters between the start and the end of its statement. Nested
+ * statements are included in the figures of the outer one, as the other
+ * execution values.
+ */
+
+/**
+ * @brief ExecutorStart hook to snapshot the usage reported by the workers of the leader.
+ * @param pending executor level of the statement
+ * @param queryDesc
+ * @param eflags
+ */
+void PgAuditLogToFile_ExecutorStart_Parallel(PendingAudit *pending, __attribute__((unused)) QueryDesc *queryDesc,
+                                             __attribute__((unused)) int eflags)
+{
+  PgAuditLogToFileBackend *slot;
+
+  pending->parallel_measured = false;
+
+  if (IsParallelWorker())
+    return;
+
+  slot = PgAuditLogToFile_backend_slot(MyProc);
+  if (slot == NULL)
+    return;
+
+  pending->parallel_workers_start = pg_atomic_read_u64(&slot->parallel_workers);
+  pending->parallel_memory_start = pg_atomic_read_u64(&slot->parallel_memory);
+  pending->parallel_cpu_usec_start = pg_atomic_read_u64(&slot->parallel_cpu_usec);
+}
+
+/**
+ * @brief Waits for the parallel workers of the statement before its usage is measured.
+ * @param pending executor level of the statement
+ * @param queryDesc
+ * @note standard_ExecutorEnd would do it anyway, doing it first makes the usage of the
+ *       workers (buffers, WAL, JIT and the shared slot) visible to our ExecutorEnd hook.
+ */
+void PgAuditLogToFile_ExecutorShutdown_Parallel(__attribute__((unused)) PendingAudit *pending, QueryDesc *queryDesc)
+{
+  MemoryContext oldcontext;
+
+  if (IsParallelWorker() || queryDesc->estate == NULL || queryDesc->planstate == NULL ||
+      !queryDesc->plannedstmt->parallelModeNeeded)
+    return;
+
+  /* Gather and Gather Merge accumulate the worker instrumentation in the query context */
+  oldcontext = MemoryContextSwitchTo(queryDesc->estate->es_query_cxt);
+  (void)ExecShutdownNode(queryDesc->planstate);
+  MemoryContextSwitchTo(oldcontext);
+}
+
+/**
+ * @brief ExecutorEnd hook to report the usage of a worker or to aggregate the workers of a leader.
+ * @param pending executor level of the statement
+ * @param queryDesc
+ * @note Requires the memory and OS resource usage of the level to be measured already.
+ */
+void PgAuditLogToFile_ExecutorEnd_Parallel(PendingAudit *pending, __attribute__((unused)) QueryDesc *queryDesc)
+{
+  PgAuditLogToFileBackend *slot;
+  double cpu_time = 0;
+
+  if (pending->rusage_measured)
+    cpu_time = pending->rusage_user_time + pending->rusage_system_time;
+
+  if (IsParallelWorker())
+  {
+    /* the leader is the lock group leader of its workers */
+    slot = PgAuditLogToFile_backend_slot(MyProc->lockGroupLeader);
+    if (slot == NULL)
+      return;
+
+    pg_atomic_fetch_add_u64(&slot->parallel_memory, (uint64)pending->memory_peak);
+    pg_atomic_fetch_add_u64(&slot->parallel_cpu_usec, (uint64)(cpu_time * 1000000.0));
+    pg_atomic_fetch_add_u64(&slot->parallel_workers, 1);
+    return;
+  }
+
+  slot = PgAuditLogToFile_backend_slot(MyProc);
+  if (slot == NULL)
+    return;
+
+  pending->parallel_workers = pg_atomic_read_u64(&slot->parallel_workers) - pending->parallel_workers_start;
+  pending->parallel_memory_peak = pending->memory_peak +
+                                  (Size)(pg_atomic_read_u64(&slot->parallel_memory) - pending->parallel_memory_start);
+  pending->parallel_cpu_time = cpu_time +
+                               (double)(pg_atomic_read_u64(&slot->parallel_cpu_usec) - pending->parallel_cpu_usec_start) / 1000000.0;
+  pending->parallel_measured = true;
+}
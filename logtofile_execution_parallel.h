@@ -0,0 +1,24 @@
+/*-------------------------------------------------------------------------
+ *
+ * logtofile_execution_parallel.h
+ *      Partial hooks to aggregate the usage of parallel query workers
+ *
+ * Copyright (c) 2026, Francisco Miguel Biete Banon
+ *
+ * This code is released under the PostgreSQL licence, as given at
+ *  http://www.postgresql.org/about/licence/
+ *-------------------------------------------------------------------------
+ */
+#ifndef _LOGTOFILE_EXECUTION_PARALLEL_H_
+#define _LOGTOFILE_EXECUTION_PARALLEL_H_
+
+#include <postgres.h>
+#include <executor/executor.h>
+
+#include "logtofile_vars.h"
+
+extern void PgAuditLogToFile_ExecutorStart_Parallel(PendingAudit *pending, QueryDesc *queryDesc, int eflags);
+extern void PgAuditLogToFile_ExecutorShutdown_Parallel(PendingAudit *pending, QueryDesc *queryDesc);
+extern void PgAuditLogToFile_ExecutorEnd_Parallel(PendingAudit *pending, QueryDesc *queryDesc);
+
+#endif
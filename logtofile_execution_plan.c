@@ -0,0 +1,127 @@
+/*-------------------------------------------------------------------------
+ *
+ * logtofile_execution_plan.c
+ *      Partial hooks to capture the plan of slow statements
+ *
+ * Copyright (c) 2026, Francisco Miguel Biete Banon
+ *
+ * This code is released under the PostgreSQL licence, as given at
+ *  http://www.postgresql.org/about/licence/
+ *-------------------------------------------------------------------------
+ */
+#include "logtofile_execution_plan.h"
+
+#include "logtofile_vars.h"
+
+#include <access/parallel.h>
+#include <commands/explain.h>
+#if (PG_VERSION_NUM >= 180000)
+#include <commands/explain_format.h>
+#include <commands/explain_state.h>
+#endif
+#include <executor/instrument.h>
+#include <lib/stringinfo.h>
+
+/* forward declaration private functions */
+static char *pgauditlogtofile_compact_json(const char *json, int len);
+
+/**
+ * @brief ExecutorStart hook to request the node instrumentation used by the analyzed plan.
+ * @param queryDesc
+ * @param eflags
+ * @note Must run before standard_ExecutorStart, the duration is still unknown so every statement pays for it.
+ */
+void PgAuditLogToFile_ExecutorStart_Plan(QueryDesc *queryDesc, int eflags)
+{
+  if (eflags & EXEC_FLAG_EXPLAIN_ONLY)
+    return;
+
+  if (guc_pgaudit_ltf_log_execution_plan_min_duration >= 0 && guc_pgaudit_ltf_log_execution_plan_analyze)
+    queryDesc->instrument_options |= INSTRUMENT_TIMER | INSTRUMENT_ROWS;
+}
+
+/**
+ * @brief ExecutorEnd hook to capture the plan when the statement exceeds the configured duration.
+ * @param pending executor level of the statement
+ * @param queryDesc
+ * @note Requires the execution time of the level to be measured already.
+ */
+void PgAuditLogToFile_ExecutorEnd_Plan(PendingAudit *pending, QueryDesc *queryDesc)
+{
+  instr_time duration;
+  ExplainState *es;
+  MemoryContext oldcontext;
+
+  pending->plan = NULL;
+
+  /* nothing to attach the plan to */
+  if (pending->records == NIL || IsParallelWorker())
+    return;
+
+  if (guc_pgaudit_ltf_log_execution_plan_min_duration < 0 ||
+      INSTR_TIME_IS_ZERO(pending->start_time) || INSTR_TIME_IS_ZERO(pending->end_time))
+    return;
+
+  duration = pending->end_time;
+  INSTR_TIME_SUBTRACT(duration, pending->start_time);
+  if (INSTR_TIME_GET_MILLISEC(duration) < guc_pgaudit_ltf_log_execution_plan_min_duration)
+    return;
+
+  /* released by standard_ExecutorEnd, after the records are written */
+  oldcontext = MemoryContextSwitchTo(queryDesc->estate->es_query_cxt);
+
+  es = NewExplainState();
+  es->format = EXPLAIN_FORMAT_JSON;
+  es->analyze = (queryDesc->instrument_options & INSTRUMENT_ROWS) != 0;
+  es->timing = (queryDesc->instrument_options & INSTRUMENT_TIMER) != 0;
+  es->buffers = (queryDesc->instrument_options & INSTRUMENT_BUFFERS) != 0;
+
+  ExplainBeginOutput(es);
+  ExplainPrintPlan(es, queryDesc);
+  ExplainEndOutput(es);
+
+  pending->plan = pgauditlogtofile_compact_json(es->str->data, es->str->len);
+
+  MemoryContextSwitchTo(oldcontext);
+}
+
+/* private functions */
+
+/**
+ * @brief Removes the indentation and line breaks of the EXPLAIN output
+ * @param json EXPLAIN (FORMAT JSON) output
+ * @param len length of the output
+ * @return char * - compacted copy
+ */
+static char *
+pgauditlogtofile_compact_json(const char *json, int len)
+{
+  char *result = palloc(len + 1);
+  char *dst = result;
+  bool in_string = false;
+  int i;
+
+  for (i = 0; i < len; i++)
+  {
+    char c = json[i];
+
+    if (in_string)
+    {
+      *dst++ = c;
+      if (c == '\\' && i + 1 < len)
+        *dst++ = json[++i];
+      else if (c == '"')
+        in_string = false;
+    }
+    else if (c == '"')
+    {
+      in_string = true;
+      *dst++ = c;
+    }
+    else if (c != ' ' && c != '\n' && c != '\t' && c != '\r')
+      *dst++ = c;
+  }
+  *dst = '\0';
+
+  return result;
+}
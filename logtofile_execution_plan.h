@@ -0,0 +1,23 @@
+/*-------------------------------------------------------------------------
+ *
+ * logtofile_execution_plan.h
+ *      Partial hooks to capture the plan of slow statements
+ *
+ * Copyright (c) 2026, Francisco Miguel Biete Banon
+ *
+ * This code is released under the PostgreSQL licence, as given at
+ *  http://www.postgresql.org/about/licence/
+ *-------------------------------------------------------------------------
+ */
+#ifndef _LOGTOFILE_EXECUTION_PLAN_H_
+#define _LOGTOFILE_EXECUTION_PLAN_H_
+
+#include <postgres.h>
+#include <executor/executor.h>
+
+#include "logtofile_vars.h"
+
+extern void PgAuditLogToFile_ExecutorStart_Plan(QueryDesc *queryDesc, int eflags);
+extern void PgAuditLogToFile_ExecutorEnd_Plan(PendingAudit *pending, QueryDesc *queryDesc);
+
+#endif
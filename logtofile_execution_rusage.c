@@ -0,0 +1,145 @@
+/*-------------------------------------------------------------------------
+ *
+ * logtofile_execution_rusage.c
+ *      Partial hooks to measure OS resource usage of execution
+ *
+ * Copyright (c) 2026, Francisco Miguel Biete Banon
+ *
+ * This code is released under the PostgreSQL licence, as given at
+ *  http://www.postgresql.org/about/licence/
+ *-------------------------------------------------------------------------
+ */
+#include "logtofile_execution_rusage.h"
+
+#include "logtofile_vars.h"
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+/* Defines */
+#define PGAUDIT_LTF_PROC_IO_PATH "/proc/self/io"
+#define PGAUDIT_LTF_PROC_IO_READ_BYTES "\nread_bytes:"
+#define PGAUDIT_LTF_PROC_IO_WRITE_BYTES "\nwrite_bytes:"
+
+/* variables to use only in this unit */
+static int pgaudit_ltf_proc_io_fd = -1;
+static bool pgaudit_ltf_proc_io_available = true;
+
+/* forward declaration private functions */
+static bool pgauditlogtofile_read_proc_io(uint64 *read_bytes, uint64 *write_bytes);
+inline static double pgauditlogtofile_timeval_diff(const struct timeval *end, const struct timeval *start) __attribute__((always_inline));
+
+/**
+ * @brief ExecutorStart hook to record the OS resource usage at the start of a statement.
+ * @param pending executor level of the statement
+ * @param queryDesc
+ * @param eflags
+ */
+void PgAuditLogToFile_ExecutorStart_Rusage(PendingAudit *pending, __attribute__((unused)) QueryDesc *queryDesc,
+                                           __attribute__((unused)) int eflags)
+{
+  pending->rusage_measured = false;
+  pending->io_measured = false;
+
+  if (getrusage(RUSAGE_SELF, &pending->rusage_start) != 0)
+    memset(&pending->rusage_start, 0, sizeof(struct rusage));
+
+  pending->io_start_valid = pgauditlogtofile_read_proc_io(&pending->io_read_bytes_start, &pending->io_write_bytes_start);
+}
+
+/**
+ * @brief ExecutorEnd hook to calculate the OS resource usage of the statement.
+ * @param pending executor level of the statement
+ * @param queryDesc
+ */
+void PgAuditLogToFile_ExecutorEnd_Rusage(PendingAudit *pending, __attribute__((unused)) QueryDesc *queryDesc)
+{
+  struct rusage rusage_end;
+  uint64 read_bytes;
+  uint64 write_bytes;
+
+  if (getrusage(RUSAGE_SELF, &rusage_end) == 0)
+  {
+    pending->rusage_user_time = pgauditlogtofile_timeval_diff(&rusage_end.ru_utime, &pending->rusage_start.ru_utime);
+    pending->rusage_system_time = pgauditlogtofile_timeval_diff(&rusage_end.ru_stime, &pending->rusage_start.ru_stime);
+    pending->rusage_nvcsw = rusage_end.ru_nvcsw - pending->rusage_start.ru_nvcsw;
+    pending->rusage_nivcsw = rusage_end.ru_nivcsw - pending->rusage_start.ru_nivcsw;
+    pending->rusage_measured = true;
+  }
+
+  if (pending->io_start_valid && pgauditlogtofile_read_proc_io(&read_bytes, &write_bytes))
+  {
+    pending->io_read_bytes = read_bytes - pending->io_read_bytes_start;
+    pending->io_write_bytes = write_bytes - pending->io_write_bytes_start;
+    pending->io_measured = true;
+  }
+}
+
+/* private functions */
+
+/**
+ * @brief Reads the storage I/O counters of the backend
+ * @param read_bytes bytes read from storage
+ * @param write_bytes bytes sent to storage
+ * @return bool - true if the counters are available
+ * @note The file is kept open and re-read with pread, procfs regenerates it on every read.
+ */
+static bool
+pgauditlogtofile_read_proc_io(uint64 *read_bytes, uint64 *write_bytes)
+{
+#ifdef __linux__
+  char buf[512];
+  ssize_t len;
+  char *read_pos;
+  char *write_pos;
+
+  if (!pgaudit_ltf_proc_io_available)
+    return false;
+
+  if (pgaudit_ltf_proc_io_fd == -1)
+  {
+    pgaudit_ltf_proc_io_fd = open(PGAUDIT_LTF_PROC_IO_PATH, O_RDONLY | O_CLOEXEC);
+    if (pgaudit_ltf_proc_io_fd == -1)
+    {
+      /* kernel without task I/O accounting, don't try again */
+      pgaudit_ltf_proc_io_available = false;
+      return false;
+    }
+  }
+
+  len = pread(pgaudit_ltf_proc_io_fd, buf, sizeof(buf) - 1, 0);
+  if (len <= 0)
+  {
+    close(pgaudit_ltf_proc_io_fd);
+    pgaudit_ltf_proc_io_fd = -1;
+    pgaudit_ltf_proc_io_available = false;
+    return false;
+  }
+  buf[len] = '\0';
+
+  read_pos = strstr(buf, PGAUDIT_LTF_PROC_IO_READ_BYTES);
+  write_pos = strstr(buf, PGAUDIT_LTF_PROC_IO_WRITE_BYTES);
+  if (read_pos == NULL || write_pos == NULL)
+    return false;
+
+  *read_bytes = strtoull(read_pos + strlen(PGAUDIT_LTF_PROC_IO_READ_BYTES), NULL, 10);
+  *write_bytes = strtoull(write_pos + strlen(PGAUDIT_LTF_PROC_IO_WRITE_BYTES), NULL, 10);
+
+  return true;
+#else
+  return false;
+#endif
+}
+
+/**
+ * @brief Difference between two timeval values
+ * @param end
+ * @param start
+ * @return double - seconds
+ */
+static double
+pgauditlogtofile_timeval_diff(const struct timeval *end, const struct timeval *start)
+{
+  return (double)(end->tv_sec - start->tv_sec) + (double)(end->tv_usec - start->tv_usec) / 1000000.0;
+}
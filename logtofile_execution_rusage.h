@@ -0,0 +1,23 @@
+/*-------------------------------------------------------------------------
+ *
+ * logtofile_execution_rusage.h
+ *      Partial hooks to measure OS resource usage of execution
+ *
+ * Copyright (c) 2026, Francisco Miguel Biete Banon
+ *
+ * This code is released under the PostgreSQL licence, as given at
+ *  http://www.postgresql.org/about/licence/
+ *-------------------------------------------------------------------------
+ */
+#ifndef _LOGTOFILE_EXECUTION_RUSAGE_H_
+#define _LOGTOFILE_EXECUTION_RUSAGE_H_
+
+#include <postgres.h>
+#include <executor/executor.h>
+
+#include "logtofile_vars.h"
+
+extern void PgAuditLogToFile_ExecutorStart_Rusage(PendingAudit *pending, QueryDesc *queryDesc, int eflags);
+extern void PgAuditLogToFile_ExecutorEnd_Rusage(PendingAudit *pending, QueryDesc *queryDesc);
+
+#endif
@@ -14,20 +14,22 @@
 
 /**
  * @brief ExecutorStart hook to record the start time of a statement.
+ * @param pending executor level of the statement
  * @param queryDesc
  * @param eflags
  */
-void PgAuditLogToFile_ExecutorStart_Time(QueryDesc *queryDesc, int eflags)
+void PgAuditLogToFile_ExecutorStart_Time(PendingAudit *pending, QueryDesc *queryDesc, int eflags)
 {
-  INSTR_TIME_SET_CURRENT(pgaudit_ltf_statement_start_time);
-  INSTR_TIME_SET_ZERO(pgaudit_ltf_statement_end_time);
+  INSTR_TIME_SET_CURRENT(pending->start_time);
+  INSTR_TIME_SET_ZERO(pending->end_time);
 }
 
 /**
  * @brief ExecutorEnd hook to calculate and log the statement execution time.
+ * @param pending executor level of the statement
  * @param queryDesc
  */
-void PgAuditLogToFile_ExecutorEnd_Time(QueryDesc *queryDesc)
+void PgAuditLogToFile_ExecutorEnd_Time(PendingAudit *pending, QueryDesc *queryDesc)
 {
-  INSTR_TIME_SET_CURRENT(pgaudit_ltf_statement_end_time);
+  INSTR_TIME_SET_CURRENT(pending->end_time);
 }
@@ -15,7 +15,9 @@
 #include <postgres.h>
 #include <executor/executor.h>
 
-extern void PgAuditLogToFile_ExecutorStart_Time(QueryDesc *queryDesc, int eflags);
-extern void PgAuditLogToFile_ExecutorEnd_Time(QueryDesc *queryDesc);
+#include "logtofile_vars.h"
+
+extern void PgAuditLogToFile_ExecutorStart_Time(PendingAudit *pending, QueryDesc *queryDesc, int eflags);
+extern void PgAuditLogToFile_ExecutorEnd_Time(PendingAudit *pending, QueryDesc *queryDesc);
 
 #endif
@@ -0,0 +1,197 @@
+/*-------------------------------------------------------------------------
+ *
+ * logtofile_fault.c
+ *      Fault injection in the audit file I/O, for testing
+ *
+ * pgaudit.debug_fault_injection is a comma separated list of faults:
+ *   open_delay=<ms>, write_delay=<ms>   sleep before every open/write
+ *   open_eio=<p>                        open fails with EIO
+ *   write_eio=<p>, write_enospc=<p>     write fails with EIO/ENOSPC
+ *   short_write=<p>                     write stores only half of the data
+ * where <p> is a probability between 0 and 1.
+ *
+ * Copyright (c) 2026, Francisco Miguel Biete Banon
+ *
+ * This code is released under the PostgreSQL licence, as given at
+ *  http://www.postgresql.org/about/licence/
+ *-------------------------------------------------------------------------
+ */
+#include "logtofile_fault.h"
+
+#include <miscadmin.h>
+#if (PG_VERSION_NUM >= 150000)
+#include <common/pg_prng.h>
+#endif
+
+#include <errno.h>
+#include <stdlib.h>
+
+typedef struct PgAuditLogToFileFault
+{
+  int open_delay_ms;
+  int write_delay_ms;
+  double open_eio;
+  double write_eio;
+  double write_enospc;
+  double short_write;
+} PgAuditLogToFileFault;
+
+char *guc_pgaudit_ltf_debug_fault_injection = NULL; // Default: ''
+
+/* variables to use only in this unit */
+static const PgAuditLogToFileFault *pgaudit_ltf_fault = NULL;
+
+/* forward declaration private functions */
+static bool pgauditlogtofile_fault_hit(double probability);
+
+/**
+ * @brief GUC Callback pgaudit.debug_fault_injection check value
+ * @param newval: new value
+ * @param extra: parsed faults
+ * @param source: source
+ * @return bool: true if the list is valid
+ */
+bool PgAuditLogToFile_fault_check(char **newval, void **extra, GucSource source)
+{
+  PgAuditLogToFileFault fault = {0};
+  PgAuditLogToFileFault *result;
+  char *spec;
+  char *item;
+  char *saveptr = NULL;
+
+  spec = pstrdup(*newval);
+  for (item = strtok_r(spec, ", ", &saveptr); item != NULL; item = strtok_r(NULL, ", ", &saveptr))
+  {
+    char *value = strchr(item, '=');
+    char *end;
+    double number;
+
+    if (value == NULL)
+    {
+      GUC_check_errdetail("Fault \"%s\" has no value.", item);
+      pfree(spec);
+      return false;
+    }
+    *value++ = '\0';
+
+    errno = 0;
+    number = strtod(value, &end);
+    if (errno != 0 || end == value || *end != '\0' || number < 0)
+    {
+      GUC_check_errdetail("Invalid value \"%s\" for fault \"%s\".", value, item);
+      pfree(spec);
+      return false;
+    }
+
+    if (strcmp(item, "open_delay") == 0)
+      fault.open_delay_ms = (int)number;
+    else if (strcmp(item, "write_delay") == 0)
+      fault.write_delay_ms = (int)number;
+    else if (strcmp(item, "open_eio") == 0 && number <= 1)
+      fault.open_eio = number;
+    else if (strcmp(item, "write_eio") == 0 && number <= 1)
+      fault.write_eio = number;
+    else if (strcmp(item, "write_enospc") == 0 && number <= 1)
+      fault.write_enospc = number;
+    else if (strcmp(item, "short_write") == 0 && number <= 1)
+      fault.short_write = number;
+    else
+    {
+      GUC_check_errdetail("Unknown fault \"%s\" or probability out of range.", item);
+      pfree(spec);
+      return false;
+    }
+  }
+  pfree(spec);
+
+#if (PG_VERSION_NUM >= 160000)
+  result = (PgAuditLogToFileFault *)guc_malloc(LOG, sizeof(PgAuditLogToFileFault));
+#else
+  result = (PgAuditLogToFileFault *)malloc(sizeof(PgAuditLogToFileFault));
+#endif
+  if (result == NULL)
+    return false;
+  *result = fault;
+  *extra = result;
+
+  return true;
+}
+
+/**
+ * @brief GUC Callback pgaudit.debug_fault_injection assign value
+ * @param newval: new value
+ * @param extra: parsed faults
+ * @return void
+ */
+void PgAuditLogToFile_fault_assign(const char *newval, void *extra)
+{
+  pgaudit_ltf_fault = (const PgAuditLogToFileFault *)extra;
+}
+
+/**
+ * @brief openat() with the configured faults
+ */
+int PgAuditLogToFile_fault_openat(int dirfd, const char *path, int flags, mode_t mode)
+{
+  const PgAuditLogToFileFault *fault = pgaudit_ltf_fault;
+
+  if (fault != NULL)
+  {
+    if (fault->open_delay_ms > 0)
+      pg_usleep(fault->open_delay_ms * 1000L);
+    if (pgauditlogtofile_fault_hit(fault->open_eio))
+    {
+      errno = EIO;
+      return -1;
+    }
+  }
+
+  return openat(dirfd, path, flags, mode);
+}
+
+/**
+ * @brief write() with the configured faults
+ */
+ssize_t PgAuditLogToFile_fault_write(int fd, const void *buf, size_t len)
+{
+  const PgAuditLogToFileFault *fault = pgaudit_ltf_fault;
+
+  if (fault != NULL)
+  {
+    if (fault->write_delay_ms > 0)
+      pg_usleep(fault->write_delay_ms * 1000L);
+    if (pgauditlogtofile_fault_hit(fault->write_enospc))
+    {
+      errno = ENOSPC;
+      return -1;
+    }
+    if (pgauditlogtofile_fault_hit(fault->write_eio))
+    {
+      errno = EIO;
+      return -1;
+    }
+    if (len > 1 && pgauditlogtofile_fault_hit(fault->short_write))
+      len /= 2;
+  }
+
+  return write(fd, buf, len);
+}
+
+/* private functions */
+
+/**
+ * @brief Decides if a fault with the given probability happens now
+ */
+static bool
+pgauditlogtofile_fault_hit(double probability)
+{
+  if (probability <= 0)
+    return false;
+  if (probability >= 1)
+    return true;
+#if (PG_VERSION_NUM >= 150000)
+  return pg_prng_double(&pg_global_prng_state) < probability;
+#else
+  return ((double)random() / MAX_RANDOM_VALUE) < probability;
+#endif
+}
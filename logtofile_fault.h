@@ -0,0 +1,45 @@
+/*-------------------------------------------------------------------------
+ *
+ * logtofile_fault.h
+ *      Fault injection in the audit file I/O, for testing
+ *
+ * Only built with FAULT_INJECTION=1 (PGAUDIT_LTF_FAULT_INJECTION), otherwise
+ * the macros are the plain system calls.
+ *
+ * Copyright (c) 2026, Francisco Miguel Biete Banon
+ *
+ * This code is released under the PostgreSQL licence, as given at
+ *  http://www.postgresql.org/about/licence/
+ *-------------------------------------------------------------------------
+ */
+#ifndef _LOGTOFILE_FAULT_H_
+#define _LOGTOFILE_FAULT_H_
+
+#include <postgres.h>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#ifdef PGAUDIT_LTF_FAULT_INJECTION
+
+#include <utils/guc.h>
+
+extern char *guc_pgaudit_ltf_debug_fault_injection;
+
+extern bool PgAuditLogToFile_fault_check(char **newval, void **extra, GucSource source);
+extern void PgAuditLogToFile_fault_assign(const char *newval, void *extra);
+
+extern int PgAuditLogToFile_fault_openat(int dirfd, const char *path, int flags, mode_t mode);
+extern ssize_t PgAuditLogToFile_fault_write(int fd, const void *buf, size_t len);
+
+#define PGAUDIT_LTF_OPENAT(dirfd, path, flags, mode) PgAuditLogToFile_fault_openat(dirfd, path, flags, mode)
+#define PGAUDIT_LTF_WRITE(fd, buf, len) PgAuditLogToFile_fault_write(fd, buf, len)
+
+#else
+
+#define PGAUDIT_LTF_OPENAT(dirfd, path, flags, mode) openat(dirfd, path, flags, mode)
+#define PGAUDIT_LTF_WRITE(fd, buf, len) write(fd, buf, len)
+
+#endif
+
+#endif
@@ -13,25 +13,76 @@
 
 #include <pgtime.h>
 #include <datatype/timestamp.h>
+#include <storage/fd.h>
 #include <utils/timestamp.h>
 
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
 #include "logtofile_vars.h"
 
 /* forward declaration private functions */
-static char *pgauditlogtofile_tm2filename(const struct pg_tm *tm);
+static char *pgauditlogtofile_tm2filename(const struct pg_tm *tm, uint32 sequence);
 
 /**
  * @brief Calculate the current filename of the log file
- * @param void
+ * @param sequence: files already rotated by size with the same log_filename expansion, 0 for the first one
  * @return char * - the current filename
  */
 char *
-PgAuditLogToFile_current_filename(void)
+PgAuditLogToFile_current_filename(uint32 sequence)
 {
   pg_time_t timet = timestamptz_to_time_t(GetCurrentTimestamp());
   struct pg_tm *tm = pg_localtime(&timet, log_timezone);
 
-  return pgauditlogtofile_tm2filename(tm);
+  return pgauditlogtofile_tm2filename(tm, sequence);
+}
+
+/**
+ * @brief Name of a shard of the audit file, with the shard number before the compression extension
+ * @param filename: buffer of MAXPGPATH bytes with the name of the audit file, replaced by the shard name
+ * @param shard: shard number
+ * @param num_shards: number of shards, 1 or less leaves the name as is
+ * @return void
+ */
+void PgAuditLogToFile_shard_filename(char *filename, int shard, int num_shards)
+{
+  static const char *const extensions[] = {".gz", ".lz4", ".zst"};
+  char extension[8] = "";
+  size_t len;
+  int i;
+
+  if (num_shards <= 1)
+    return;
+
+  len = strlen(filename);
+  for (i = 0; i < lengthof(extensions); i++)
+  {
+    size_t ext_len = strlen(extensions[i]);
+
+    if (len > ext_len && strcmp(filename + len - ext_len, extensions[i]) == 0)
+    {
+      strlcpy(extension, extensions[i], sizeof(extension));
+      len -= ext_len;
+      break;
+    }
+  }
+
+  pg_snprintf(filename + len, MAXPGPATH - len, ".shard%d%s", shard, extension);
+}
+
+/**
+ * @brief Interval of the time-based rotation
+ * @param void
+ * @return int - seconds, pgaudit.log_rotation_age_seconds if set or else pgaudit.log_rotation_age, 0 if disabled
+ */
+int PgAuditLogToFile_rotation_interval(void)
+{
+  if (guc_pgaudit_ltf_log_rotation_age_seconds > 0)
+    return guc_pgaudit_ltf_log_rotation_age_seconds;
+
+  return guc_pgaudit_ltf_log_rotation_age * SECS_PER_MINUTE;
 }
 
 /**
@@ -47,7 +98,8 @@ void PgAuditLogToFile_set_next_rotation_time(void)
   int rotinterval;
 
   /* nothing to do if time-based rotation is disabled */
-  if (guc_pgaudit_ltf_log_rotation_age < 1)
+  rotinterval = PgAuditLogToFile_rotation_interval();
+  if (rotinterval < 1)
     return;
 
   /*
@@ -56,7 +108,6 @@ void PgAuditLogToFile_set_next_rotation_time(void)
    * fairly loosely.  In this version we align to log_timezone rather than
    * GMT.
    */
-  rotinterval = guc_pgaudit_ltf_log_rotation_age * SECS_PER_MINUTE; /* convert to seconds */
   now = (pg_time_t)time(NULL);
   tm = pg_localtime(&now, log_timezone);
   now += tm->tm_gmtoff;
@@ -68,15 +119,86 @@ void PgAuditLogToFile_set_next_rotation_time(void)
   LWLockRelease(&pgaudit_ltf_shm->lock);
 }
 
+/**
+ * @brief Creates the audit file before it's published, so the backends only need to open it
+ * @param filename: audit file
+ * @return void
+ * @note The directory is created too, and the file preallocated up to log_rotation_size when possible
+ */
+void PgAuditLogToFile_create_file(const char *filename)
+{
+  mode_t oumask;
+  int fd;
+  struct stat st;
+
+  if (stat(filename, &st) == 0)
+    return;
+
+  /* Create spool directory if not present; ignore errors */
+  (void)MakePGDirectory(guc_pgaudit_ltf_log_directory);
+
+  /*
+   * Note we do not let guc_pgaudit_ltf_log_file_mode disable IWUSR, since we certainly want
+   * to be able to write the files ourselves.
+   */
+  oumask = umask(
+      (mode_t)((~(guc_pgaudit_ltf_log_file_mode | S_IWUSR)) & (S_IRWXU | S_IRWXG | S_IRWXO)));
+  fd = open(filename, O_CREAT | O_WRONLY | O_APPEND | PG_BINARY, guc_pgaudit_ltf_log_file_mode);
+  umask(oumask);
+
+  if (fd == -1)
+  {
+    ereport(LOG, (errcode_for_file_access(),
+                  errmsg("pgauditlogtofile could not create audit file \"%s\": %m", filename)));
+    return;
+  }
+
+#ifdef FALLOC_FL_KEEP_SIZE
+  /* blocks past the end of the file, appends fill them without changing the size seen by readers; the limit is shared by the shards */
+  if (guc_pgaudit_ltf_log_rotation_size > 0 &&
+      fallocate(fd, FALLOC_FL_KEEP_SIZE, 0,
+                (off_t)guc_pgaudit_ltf_log_rotation_size * 1024 / Max(guc_pgaudit_ltf_log_shards, 1)) != 0)
+    ereport(DEBUG1, (errcode_for_file_access(),
+                     errmsg("pgauditlogtofile could not preallocate audit file \"%s\": %m", filename)));
+#endif
+
+  close(fd);
+}
+
+/**
+ * @brief Releases the blocks preallocated past the end of a file that will not be written anymore
+ * @param filename: audit file closed by all backends
+ * @return void
+ */
+void PgAuditLogToFile_trim_file(const char *filename)
+{
+#ifdef FALLOC_FL_KEEP_SIZE
+  int fd;
+  struct stat st;
+
+  fd = open(filename, O_WRONLY | PG_BINARY, 0);
+  if (fd == -1)
+    return;
+
+  /* truncating to the same size drops the blocks allocated with FALLOC_FL_KEEP_SIZE */
+  if (fstat(fd, &st) == 0 && ftruncate(fd, st.st_size) != 0)
+    ereport(LOG, (errcode_for_file_access(),
+                  errmsg("pgauditlogtofile could not trim audit file \"%s\": %m", filename)));
+
+  close(fd);
+#endif
+}
+
 /* private functions */
 
 /**
  * @brief Convert a pg_tm structure to a filename
  * @param tm - the pg_tm structure
+ * @param sequence - suffix of the size rotations, 0 for none
  * @return char * - the filename
  */
 static char *
-pgauditlogtofile_tm2filename(const struct pg_tm *tm)
+pgauditlogtofile_tm2filename(const struct pg_tm *tm, uint32 sequence)
 {
   char *filename = NULL;
   int len;
@@ -91,6 +213,13 @@ pgauditlogtofile_tm2filename(const struct pg_tm *tm)
   /* Append formatted timestamp-based filename */
   pg_strftime(filename + len, MAXPGPATH - len, guc_pgaudit_ltf_log_filename, tm);
 
+  /* size rotations within the same time pattern, before the compression extension */
+  if (sequence > 0)
+  {
+    len = strlen(filename);
+    pg_snprintf(filename + len, MAXPGPATH - len, ".%u", sequence);
+  }
+
   switch (guc_pgaudit_ltf_log_compression)
   {
   case PGAUDIT_LTF_COMPRESSION_GZIP:
@@ -14,7 +14,11 @@
 
 #include "postgres.h"
 
-extern char *PgAuditLogToFile_current_filename(void);
+extern char *PgAuditLogToFile_current_filename(uint32 sequence);
+extern void PgAuditLogToFile_shard_filename(char *filename, int shard, int num_shards);
+extern int PgAuditLogToFile_rotation_interval(void);
 extern void PgAuditLogToFile_set_next_rotation_time(void);
+extern void PgAuditLogToFile_create_file(const char *filename);
+extern void PgAuditLogToFile_trim_file(const char *filename);
 
 #endif // _LOGTOFILE_FILENAME_H_
\ No newline at end of file
@@ -11,6 +11,7 @@
  */
 #include "logtofile_json.h"
 
+#include "logtofile_execution_jit.h"
 #include "logtofile_string_format.h"
 #include "logtofile_vars.h"
 
@@ -35,9 +36,12 @@ inline static void pgauditlogtofile_pgaudit2json(StringInfo buf, char *message)
  * @param buf: buffer to write the json string
  * @param edata: error data
  * @param exclude_nchars: number of characters to exclude from pgaudit message
+ * @param pending: executor level with the statement stats, NULL if there are none
+ * @param sequence: global sequence number of the record
  * @return void
  */
-void PgAuditLogToFile_json_audit(StringInfo buf, const ErrorData *edata, int exclude_nchars)
+void PgAuditLogToFile_json_audit(StringInfo buf, const ErrorData *edata, int exclude_nchars,
+                                 const PendingAudit *pending, uint64 sequence)
 {
   char formatted_log_time[FORMATTED_TS_LEN];
   instr_time now_instr;
@@ -45,7 +49,6 @@ void PgAuditLogToFile_json_audit(StringInfo buf, const ErrorData *edata, int exc
   int displen;
   double total_time;
   instr_time duration;
-  Size memory_usage;
 
   /* json record start */
   appendStringInfoString(buf, "{\"log.source\":\"pgauditlogtofile\"");
@@ -57,6 +60,9 @@ void PgAuditLogToFile_json_audit(StringInfo buf, const ErrorData *edata, int exc
   appendStringInfoString(buf, ",\"timestamp\":");
   escape_json(buf, formatted_log_time);
 
+  /* sequence number */
+  appendStringInfo(buf, ",\"custom.sequence\":\"" UINT64_FORMAT "\"", sequence);
+
   /* username */
   if (MyProcPort && MyProcPort->user_name)
   {
@@ -163,39 +169,83 @@ void PgAuditLogToFile_json_audit(StringInfo buf, const ErrorData *edata, int exc
     escape_json(buf, edata->context);
   }
 
-  if (guc_pgaudit_ltf_log_execution_time &&
-      !INSTR_TIME_IS_ZERO(pgaudit_ltf_statement_start_time) &&
-      !INSTR_TIME_IS_ZERO(pgaudit_ltf_statement_end_time))
+  if (guc_pgaudit_ltf_log_execution_time && pending != NULL &&
+      !INSTR_TIME_IS_ZERO(pending->start_time) &&
+      !INSTR_TIME_IS_ZERO(pending->end_time))
   {
-    PgAuditLogToFile_format_instr_time_nanos(pgaudit_ltf_statement_start_time, formatted_log_time, sizeof(formatted_log_time));
+    PgAuditLogToFile_format_instr_time_nanos(pending->start_time, formatted_log_time, sizeof(formatted_log_time));
     appendStringInfoString(buf, ",\"custom.execution_start\":");
     escape_json(buf, formatted_log_time);
 
-    PgAuditLogToFile_format_instr_time_nanos(pgaudit_ltf_statement_end_time, formatted_log_time, sizeof(formatted_log_time));
+    PgAuditLogToFile_format_instr_time_nanos(pending->end_time, formatted_log_time, sizeof(formatted_log_time));
     appendStringInfoString(buf, ",\"custom.execution_end\":");
     escape_json(buf, formatted_log_time);
 
-    duration = pgaudit_ltf_statement_end_time;
-    INSTR_TIME_SUBTRACT(duration, pgaudit_ltf_statement_start_time);
+    duration = pending->end_time;
+    INSTR_TIME_SUBTRACT(duration, pending->start_time);
     total_time = INSTR_TIME_GET_DOUBLE(duration);
     appendStringInfo(buf, ",\"custom.execution_time\":\"%.9f\"", total_time);
+  }
+
+  if (guc_pgaudit_ltf_log_execution_memory && pending != NULL &&
+      pending->memory_start > 0 &&
+      pending->memory_end > 0)
+  {
+    appendStringInfo(buf, ",\"custom.execution_memory.start\":\"%ld\"", (long)pending->memory_start);
+    appendStringInfo(buf, ",\"custom.execution_memory.end\":\"%ld\"", (long)pending->memory_end);
+    appendStringInfo(buf, ",\"custom.execution_memory.peak\":\"%ld\"", (long)pending->memory_peak);
+    appendStringInfo(buf, ",\"custom.execution_memory.delta\":\"%ld\"",
+                     (long)(pending->memory_end > pending->memory_start ? pending->memory_end - pending->memory_start : 0));
+  }
+
+  if (guc_pgaudit_ltf_log_execution_buffers && pending != NULL && pending->buffers_measured)
+  {
+    appendStringInfo(buf, ",\"custom.execution_buffers.shared_blks_hit\":\"" INT64_FORMAT "\"", pending->buffers.shared_blks_hit);
+    appendStringInfo(buf, ",\"custom.execution_buffers.shared_blks_read\":\"" INT64_FORMAT "\"", pending->buffers.shared_blks_read);
+    appendStringInfo(buf, ",\"custom.execution_buffers.shared_blks_dirtied\":\"" INT64_FORMAT "\"", pending->buffers.shared_blks_dirtied);
+    appendStringInfo(buf, ",\"custom.execution_buffers.shared_blks_written\":\"" INT64_FORMAT "\"", pending->buffers.shared_blks_written);
+    appendStringInfo(buf, ",\"custom.execution_buffers.local_blks_hit\":\"" INT64_FORMAT "\"", pending->buffers.local_blks_hit);
+    appendStringInfo(buf, ",\"custom.execution_buffers.local_blks_read\":\"" INT64_FORMAT "\"", pending->buffers.local_blks_read);
+    appendStringInfo(buf, ",\"custom.execution_buffers.local_blks_dirtied\":\"" INT64_FORMAT "\"", pending->buffers.local_blks_dirtied);
+    appendStringInfo(buf, ",\"custom.execution_buffers.local_blks_written\":\"" INT64_FORMAT "\"", pending->buffers.local_blks_written);
+    appendStringInfo(buf, ",\"custom.execution_buffers.temp_blks_read\":\"" INT64_FORMAT "\"", pending->buffers.temp_blks_read);
+    appendStringInfo(buf, ",\"custom.execution_buffers.temp_blks_written\":\"" INT64_FORMAT "\"", pending->buffers.temp_blks_written);
+    appendStringInfo(buf, ",\"custom.execution_wal.records\":\"" INT64_FORMAT "\"", pending->wal.wal_records);
+    appendStringInfo(buf, ",\"custom.execution_wal.fpi\":\"" INT64_FORMAT "\"", pending->wal.wal_fpi);
+    appendStringInfo(buf, ",\"custom.execution_wal.bytes\":\"" UINT64_FORMAT "\"", pending->wal.wal_bytes);
+  }
+
+  if (guc_pgaudit_ltf_log_execution_jit && pending != NULL && pending->jit_measured)
+  {
+    appendStringInfo(buf, ",\"custom.execution_jit.functions\":\"%zu\"", pending->jit.created_functions);
+    appendStringInfo(buf, ",\"custom.execution_jit.time\":\"%.9f\"", PgAuditLogToFile_jit_total_time(&pending->jit));
+  }
+
+  if (guc_pgaudit_ltf_log_execution_rusage && pending != NULL && pending->rusage_measured)
+  {
+    appendStringInfo(buf, ",\"custom.execution_rusage.user_time\":\"%.6f\"", pending->rusage_user_time);
+    appendStringInfo(buf, ",\"custom.execution_rusage.system_time\":\"%.6f\"", pending->rusage_system_time);
+    appendStringInfo(buf, ",\"custom.execution_rusage.voluntary_switches\":\"%ld\"", pending->rusage_nvcsw);
+    appendStringInfo(buf, ",\"custom.execution_rusage.involuntary_switches\":\"%ld\"", pending->rusage_nivcsw);
+  }
 
-    INSTR_TIME_SET_ZERO(pgaudit_ltf_statement_start_time);
-    INSTR_TIME_SET_ZERO(pgaudit_ltf_statement_end_time);
+  if (guc_pgaudit_ltf_log_execution_rusage && pending != NULL && pending->io_measured)
+  {
+    appendStringInfo(buf, ",\"custom.execution_io.read_bytes\":\"" UINT64_FORMAT "\"", pending->io_read_bytes);
+    appendStringInfo(buf, ",\"custom.execution_io.write_bytes\":\"" UINT64_FORMAT "\"", pending->io_write_bytes);
+  }
+
+  if (guc_pgaudit_ltf_log_execution_parallel && pending != NULL && pending->parallel_measured)
+  {
+    appendStringInfo(buf, ",\"custom.execution_parallel.workers\":\"" UINT64_FORMAT "\"", pending->parallel_workers);
+    appendStringInfo(buf, ",\"custom.execution_parallel.memory_peak\":\"%ld\"", (long)pending->parallel_memory_peak);
+    appendStringInfo(buf, ",\"custom.execution_parallel.cpu_time\":\"%.6f\"", pending->parallel_cpu_time);
   }
 
-  if (guc_pgaudit_ltf_log_execution_memory &&
-      pgaudit_ltf_statement_memory_start > 0 &&
-      pgaudit_ltf_statement_memory_end > 0)
+  if (pending != NULL && pending->plan != NULL)
   {
-    memory_usage = pgaudit_ltf_statement_memory_end - pgaudit_ltf_statement_memory_start;
-    appendStringInfo(buf, ",\"custom.execution_memory.start\":\"%ld\"", (long)pgaudit_ltf_statement_memory_start);
-    appendStringInfo(buf, ",\"custom.execution_memory.end\":\"%ld\"", (long)pgaudit_ltf_statement_memory_end);
-    appendStringInfo(buf, ",\"custom.execution_memory.peak\":\"%ld\"", (long)pgaudit_ltf_statement_memory_peak);
-    appendStringInfo(buf, ",\"custom.execution_memory.delta\":\"%ld\"", (long)(memory_usage < 0 ? 0 : memory_usage));
-
-    pgaudit_ltf_statement_memory_start = 0;
-    pgaudit_ltf_statement_memory_end = 0;
+    appendStringInfoString(buf, ",\"custom.execution_plan\":");
+    escape_json(buf, pending->plan);
   }
 
   appendStringInfoCharMacro(buf, '}');
@@ -15,7 +15,10 @@
 #include <postgres.h>
 #include <lib/stringinfo.h>
 
+#include "logtofile_vars.h"
+
 /* Hook functions */
-extern void PgAuditLogToFile_json_audit(StringInfo buf, const ErrorData *edata, int exclude_nchars);
+extern void PgAuditLogToFile_json_audit(StringInfo buf, const ErrorData *edata, int exclude_nchars,
+                                        const PendingAudit *pending, uint64 sequence);
 
 #endif
@@ -0,0 +1,340 @@
+/*-------------------------------------------------------------------------
+ *
+ * logtofile_latency.c
+ *      Latency histograms of the audit write pipeline
+ *
+ * Copyright (c) 2026, Francisco Miguel Biete Banon
+ *
+ * This code is released under the PostgreSQL licence, as given at
+ *  http://www.postgresql.org/about/licence/
+ *-------------------------------------------------------------------------
+ */
+#include "logtofile_latency.h"
+
+#include "logtofile_shmem.h"
+#include "logtofile_vars.h"
+
+#include <funcapi.h>
+#include <miscadmin.h>
+#include <port/pg_bitutils.h>
+#include <storage/ipc.h>
+#include <storage/lwlock.h>
+#include <storage/pg_shmem.h>
+#include <storage/proc.h>
+#include <storage/shmem.h>
+#include <utils/builtins.h>
+#include <utils/tuplestore.h>
+
+/* Defines */
+#define PGAUDIT_LTF_LATENCY_COLS 4
+#define PGAUDIT_LTF_LATENCY_SUB_COUNT (1 << PGAUDIT_LTF_LATENCY_SUB_BITS)
+
+static const char *const pgaudit_ltf_stage_names[PGAUDIT_LTF_STAGE_COUNT] = {
+    "capture",
+    "format",
+    "compress",
+    "write"};
+
+/* variables to use only in this unit */
+static PgAuditLogToFileLatency *pgaudit_ltf_latency_local = NULL;
+static bool pgaudit_ltf_latency_released = false;
+
+/* forward declaration private functions */
+static PgAuditLogToFileLatency *pgauditlogtofile_latency_local(void);
+static void pgauditlogtofile_latency_release(int code, Datum arg);
+static int pgauditlogtofile_latency_bucket(uint64 nanos);
+static uint64 pgauditlogtofile_latency_bucket_lower(int bucket);
+
+PG_FUNCTION_INFO_V1(pgauditlogtofile_latency_histogram);
+PG_FUNCTION_INFO_V1(pgauditlogtofile_latency_reset);
+
+/**
+ * @brief Shared memory required by the histograms
+ * @param num_backends: number of backend slots
+ * @return size_t - bytes, 0 if the histograms are disabled
+ */
+size_t PgAuditLogToFile_latency_shmem_size(int num_backends)
+{
+  if (!guc_pgaudit_ltf_log_latency_histograms)
+    return 0;
+
+  /* the extra entry accumulates the backends that already exited */
+  return MAXALIGN(mul_size(num_backends + 1, sizeof(PgAuditLogToFileLatency)));
+}
+
+/**
+ * @brief Initializes the histograms in shared memory
+ * @param num_backends: number of backend slots
+ * @return void
+ */
+void PgAuditLogToFile_latency_shmem_init(int num_backends)
+{
+  size_t size = PgAuditLogToFile_latency_shmem_size(num_backends);
+
+  pg_atomic_init_u32(&pgaudit_ltf_shm->latency_reset_generation, 0);
+
+  if (size == 0)
+  {
+    pgaudit_ltf_shm->latency = NULL;
+    return;
+  }
+
+  pgaudit_ltf_shm->latency = (PgAuditLogToFileLatency *)ShmemAlloc(size);
+  memset(pgaudit_ltf_shm->latency, 0, size);
+}
+
+/**
+ * @brief Adds the latency of a stage to the histogram of the backend
+ * @param stage: stage measured
+ * @param start: start time of the stage
+ * @return void
+ */
+void PgAuditLogToFile_latency_add(PgAuditLogToFileStage stage, const instr_time *start)
+{
+  PgAuditLogToFileLatency *latency = pgauditlogtofile_latency_local();
+  uint32 generation;
+  instr_time duration;
+  uint64 nanos;
+
+  if (latency == NULL)
+    return;
+
+  /* a reset was requested, only the owner may clear its buckets */
+  generation = pg_atomic_read_u32(&pgaudit_ltf_shm->latency_reset_generation);
+  if (latency->reset_generation != generation)
+  {
+    memset(latency->buckets, 0, sizeof(latency->buckets));
+    pg_write_barrier();
+    latency->reset_generation = generation;
+  }
+
+  INSTR_TIME_SET_CURRENT(duration);
+  INSTR_TIME_SUBTRACT(duration, *start);
+#if (PG_VERSION_NUM >= 160000)
+  nanos = (uint64)INSTR_TIME_GET_NANOSEC(duration);
+#else
+  nanos = (uint64)INSTR_TIME_GET_MICROSEC(duration) * 1000;
+#endif
+
+  latency->buckets[stage][pgauditlogtofile_latency_bucket(nanos)]++;
+}
+
+/**
+ * @brief SQL function - non empty buckets of every stage
+ * @return Datum - set of (stage, lower_ns, upper_ns, count)
+ */
+Datum pgauditlogtofile_latency_histogram(PG_FUNCTION_ARGS)
+{
+  ReturnSetInfo *rsinfo = (ReturnSetInfo *)fcinfo->resultinfo;
+  TupleDesc tupdesc;
+  Tuplestorestate *tupstore;
+  MemoryContext oldcontext;
+  PgAuditLogToFileLatency *total;
+  uint32 generation;
+  int i;
+  int stage;
+  int bucket;
+
+  if (rsinfo == NULL || !IsA(rsinfo, ReturnSetInfo))
+    ereport(ERROR,
+            (errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+             errmsg("set-valued function called in context that cannot accept a set")));
+  if (!(rsinfo->allowedModes & SFRM_Materialize))
+    ereport(ERROR,
+            (errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+             errmsg("materialize mode required, but it is not allowed in this context")));
+  if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+    elog(ERROR, "return type must be a row type");
+
+  if (UsedShmemSegAddr == NULL || pgaudit_ltf_shm == NULL)
+    ereport(ERROR,
+            (errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+             errmsg("pgauditlogtofile must be loaded via shared_preload_libraries")));
+
+  oldcontext = MemoryContextSwitchTo(rsinfo->econtext->ecxt_per_query_memory);
+  tupstore = tuplestore_begin_heap(true, false, work_mem);
+  rsinfo->returnMode = SFRM_Materialize;
+  rsinfo->setResult = tupstore;
+  rsinfo->setDesc = tupdesc;
+  MemoryContextSwitchTo(oldcontext);
+
+  /* empty set when disabled */
+  if (pgaudit_ltf_shm->latency == NULL)
+    return (Datum)0;
+
+  total = (PgAuditLogToFileLatency *)palloc0(sizeof(PgAuditLogToFileLatency));
+
+  LWLockAcquire(&pgaudit_ltf_shm->lock, LW_SHARED);
+  generation = pg_atomic_read_u32(&pgaudit_ltf_shm->latency_reset_generation);
+  for (i = 0; i <= pgaudit_ltf_shm->num_backends; i++)
+  {
+    PgAuditLogToFileLatency *latency = &pgaudit_ltf_shm->latency[i];
+
+    /* not cleared by its owner since the last reset */
+    if (latency->reset_generation != generation)
+      continue;
+
+    pg_read_barrier();
+    for (stage = 0; stage < PGAUDIT_LTF_STAGE_COUNT; stage++)
+      for (bucket = 0; bucket < PGAUDIT_LTF_LATENCY_BUCKETS; bucket++)
+        total->buckets[stage][bucket] += latency->buckets[stage][bucket];
+  }
+  LWLockRelease(&pgaudit_ltf_shm->lock);
+
+  for (stage = 0; stage < PGAUDIT_LTF_STAGE_COUNT; stage++)
+  {
+    for (bucket = 0; bucket < PGAUDIT_LTF_LATENCY_BUCKETS; bucket++)
+    {
+      Datum values[PGAUDIT_LTF_LATENCY_COLS];
+      bool nulls[PGAUDIT_LTF_LATENCY_COLS];
+
+      if (total->buckets[stage][bucket] == 0)
+        continue;
+
+      memset(nulls, 0, sizeof(nulls));
+      values[0] = CStringGetTextDatum(pgaudit_ltf_stage_names[stage]);
+      values[1] = Int64GetDatum((int64)pgauditlogtofile_latency_bucket_lower(bucket));
+      if (bucket == PGAUDIT_LTF_LATENCY_BUCKETS - 1)
+        nulls[2] = true; /* overflow bucket */
+      else
+        values[2] = Int64GetDatum((int64)pgauditlogtofile_latency_bucket_lower(bucket + 1) - 1);
+      values[3] = Int64GetDatum((int64)total->buckets[stage][bucket]);
+
+      tuplestore_putvalues(tupstore, tupdesc, values, nulls);
+    }
+  }
+
+  pfree(total);
+
+  return (Datum)0;
+}
+
+/**
+ * @brief SQL function - resets the histograms of every backend
+ * @return Datum - void
+ */
+Datum pgauditlogtofile_latency_reset(PG_FUNCTION_ARGS)
+{
+  if (UsedShmemSegAddr == NULL || pgaudit_ltf_shm == NULL)
+    ereport(ERROR,
+            (errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+             errmsg("pgauditlogtofile must be loaded via shared_preload_libraries")));
+
+  if (pgaudit_ltf_shm->latency == NULL)
+    PG_RETURN_VOID();
+
+  /* backends clear their own buckets when they see the new generation */
+  LWLockAcquire(&pgaudit_ltf_shm->lock, LW_EXCLUSIVE);
+  memset(pgaudit_ltf_shm->latency[pgaudit_ltf_shm->num_backends].buckets, 0,
+         sizeof(pgaudit_ltf_shm->latency[pgaudit_ltf_shm->num_backends].buckets));
+  pgaudit_ltf_shm->latency[pgaudit_ltf_shm->num_backends].reset_generation =
+      pg_atomic_add_fetch_u32(&pgaudit_ltf_shm->latency_reset_generation, 1);
+  LWLockRelease(&pgaudit_ltf_shm->lock);
+
+  PG_RETURN_VOID();
+}
+
+/* private functions */
+
+/**
+ * @brief Histograms of the backend, the slot is claimed the first time it is needed
+ * @return PgAuditLogToFileLatency * - histograms or NULL if disabled or the backend has no slot
+ */
+static PgAuditLogToFileLatency *
+pgauditlogtofile_latency_local(void)
+{
+  PgAuditLogToFileBackend *backend;
+
+  if (pgaudit_ltf_latency_local != NULL)
+    return pgaudit_ltf_latency_local;
+
+  if (pgaudit_ltf_latency_released || MyProc == NULL ||
+      UsedShmemSegAddr == NULL || pgaudit_ltf_shm == NULL || pgaudit_ltf_shm->latency == NULL)
+    return NULL;
+
+  backend = PgAuditLogToFile_backend_slot(MyProc);
+  if (backend == NULL)
+    return NULL;
+
+  pgaudit_ltf_latency_local = &pgaudit_ltf_shm->latency[backend - pgaudit_ltf_shm->backends];
+
+  /* a previous owner of the slot may have left values */
+  memset(pgaudit_ltf_latency_local->buckets, 0, sizeof(pgaudit_ltf_latency_local->buckets));
+  pg_write_barrier();
+  pgaudit_ltf_latency_local->reset_generation = pg_atomic_read_u32(&pgaudit_ltf_shm->latency_reset_generation);
+
+  before_shmem_exit(pgauditlogtofile_latency_release, (Datum)0);
+
+  return pgaudit_ltf_latency_local;
+}
+
+/**
+ * @brief Exit callback - moves the histograms of the backend to the exited backends entry
+ * @param code: unused
+ * @param arg: unused
+ * @return void
+ */
+static void
+pgauditlogtofile_latency_release(int code, Datum arg)
+{
+  PgAuditLogToFileLatency *exited;
+  int stage;
+  int bucket;
+
+  if (pgaudit_ltf_latency_local == NULL)
+    return;
+
+  exited = &pgaudit_ltf_shm->latency[pgaudit_ltf_shm->num_backends];
+
+  LWLockAcquire(&pgaudit_ltf_shm->lock, LW_EXCLUSIVE);
+  if (pgaudit_ltf_latency_local->reset_generation == exited->reset_generation)
+  {
+    for (stage = 0; stage < PGAUDIT_LTF_STAGE_COUNT; stage++)
+      for (bucket = 0; bucket < PGAUDIT_LTF_LATENCY_BUCKETS; bucket++)
+        exited->buckets[stage][bucket] += pgaudit_ltf_latency_local->buckets[stage][bucket];
+  }
+  /* not visible to readers anymore */
+  pgaudit_ltf_latency_local->reset_generation = PG_UINT32_MAX;
+  LWLockRelease(&pgaudit_ltf_shm->lock);
+
+  pgaudit_ltf_latency_local = NULL;
+  pgaudit_ltf_latency_released = true;
+}
+
+/**
+ * @brief Bucket of a latency
+ * @param nanos: latency in nanoseconds
+ * @return int - bucket, values below 2^SUB_BITS have one bucket each
+ */
+static int
+pgauditlogtofile_latency_bucket(uint64 nanos)
+{
+  int exponent;
+  int bucket;
+
+  if (nanos < PGAUDIT_LTF_LATENCY_SUB_COUNT)
+    return (int)nanos;
+
+  exponent = pg_leftmost_one_pos64(nanos);
+  bucket = ((exponent - PGAUDIT_LTF_LATENCY_SUB_BITS + 1) << PGAUDIT_LTF_LATENCY_SUB_BITS) +
+           (int)((nanos >> (exponent - PGAUDIT_LTF_LATENCY_SUB_BITS)) & (PGAUDIT_LTF_LATENCY_SUB_COUNT - 1));
+
+  return Min(bucket, PGAUDIT_LTF_LATENCY_BUCKETS - 1);
+}
+
+/**
+ * @brief Lower bound of a bucket
+ * @param bucket: bucket
+ * @return uint64 - nanoseconds
+ */
+static uint64
+pgauditlogtofile_latency_bucket_lower(int bucket)
+{
+  int shift;
+
+  if (bucket < PGAUDIT_LTF_LATENCY_SUB_COUNT)
+    return (uint64)bucket;
+
+  shift = (bucket >> PGAUDIT_LTF_LATENCY_SUB_BITS) - 1;
+  return ((uint64)(PGAUDIT_LTF_LATENCY_SUB_COUNT + (bucket & (PGAUDIT_LTF_LATENCY_SUB_COUNT - 1)))) << shift;
+}
@@ -0,0 +1,54 @@
+/*-------------------------------------------------------------------------
+ *
+ * logtofile_latency.h
+ *      Latency histograms of the audit write pipeline
+ *
+ * Copyright (c) 2026, Francisco Miguel Biete Banon
+ *
+ * This code is released under the PostgreSQL licence, as given at
+ *  http://www.postgresql.org/about/licence/
+ *-------------------------------------------------------------------------
+ */
+#ifndef _LOGTOFILE_LATENCY_H_
+#define _LOGTOFILE_LATENCY_H_
+
+#include <postgres.h>
+#include <fmgr.h>
+#include <portability/instr_time.h>
+
+#include "logtofile_vars.h"
+
+extern size_t PgAuditLogToFile_latency_shmem_size(int num_backends);
+extern void PgAuditLogToFile_latency_shmem_init(int num_backends);
+extern void PgAuditLogToFile_latency_add(PgAuditLogToFileStage stage, const instr_time *start);
+
+/**
+ * @brief Starts measuring a stage
+ * @param start: where to keep the start time, zero if the histograms are disabled
+ */
+static inline void
+PgAuditLogToFile_latency_start(instr_time *start)
+{
+  if (guc_pgaudit_ltf_log_latency_histograms)
+    INSTR_TIME_SET_CURRENT(*start);
+  else
+    INSTR_TIME_SET_ZERO(*start);
+}
+
+/**
+ * @brief Finishes measuring a stage and adds it to the histogram
+ * @param stage: stage measured
+ * @param start: start time set by PgAuditLogToFile_latency_start
+ */
+static inline void
+PgAuditLogToFile_latency_end(PgAuditLogToFileStage stage, const instr_time *start)
+{
+  if (!INSTR_TIME_IS_ZERO(*start))
+    PgAuditLogToFile_latency_add(stage, start);
+}
+
+/* SQL functions */
+extern Datum pgauditlogtofile_latency_histogram(PG_FUNCTION_ARGS);
+extern Datum pgauditlogtofile_latency_reset(PG_FUNCTION_ARGS);
+
+#endif
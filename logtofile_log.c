@@ -11,16 +11,25 @@
  */
 #include "logtofile_log.h"
 
-#include "logtofile_autoclose.h"
+#include "logtofile_close_barrier.h"
 #include "logtofile_csv.h"
-#include "logtofile_errordata.h"
+#include "logtofile_fault.h"
+#include "logtofile_filename.h"
 #include "logtofile_guc.h"
 #include "logtofile_json.h"
+#include "logtofile_latency.h"
+#include "logtofile_pending.h"
+#include "logtofile_probes.h"
+#include "logtofile_sequence.h"
+#include "logtofile_signal_handler.h"
 #include "logtofile_shmem.h"
+#include "logtofile_stats.h"
+#include "logtofile_wait_event.h"
 #include "logtofile_vars.h"
 
 #include <lib/stringinfo.h>
 #include <port/atomics.h>
+#include <postmaster/bgworker.h>
 #include <postmaster/syslogger.h>
 #include <storage/fd.h>
 #include <storage/ipc.h>
@@ -30,7 +39,6 @@
 #include <utils/timestamp.h>
 #include <utils/memutils.h>
 
-#include <pthread.h>
 #include <fcntl.h>
 #include <unistd.h>
 #include <sys/stat.h>
@@ -46,7 +54,8 @@
 
 /* variables to use only in this unit */
 static char filename_in_use[MAXPGPATH];
-static int autoclose_thread_status_debug = 0; // 0: new proc, 1: th running, 2: th running sleep used, 3: th closed
+static int pgaudit_ltf_dir_fd = -1;
+static char pgaudit_ltf_dir_path[MAXPGPATH];
 static uint32 pgaudit_ltf_local_rotation_generation = 0;
 static z_stream *pgaudit_ltf_zstream = NULL;
 static int pgaudit_ltf_gzip_level = 0;
@@ -60,28 +69,34 @@ static bool pgauditlogtofile_is_enabled(void);
 static bool pgauditlogtofile_is_open_file(void);
 static bool pgauditlogtofile_is_prefixed(const char *msg);
 static bool pgauditlogtofile_open_file(void);
-static bool pgauditlogtofile_record_audit(const ErrorData *edata, int exclude_nchars);
-static bool pgauditlogtofile_write_audit(const ErrorData *edata, int exclude_nchars);
-static void pgauditlogtofile_format_audit(StringInfo buf, const ErrorData *edata, int exclude_nchars);
-static bool pgauditlogtofile_compress_audit(const char *src, size_t src_len, char **dst, size_t *dst_len);
+static int pgauditlogtofile_open_current(const char *filename, uint32 generation);
+static int pgauditlogtofile_openat(const char *filename, int flags);
+static bool pgauditlogtofile_record_audit(const ErrorData *edata, int exclude_nchars, const PendingAudit *pending);
+static bool pgauditlogtofile_write_audit(const ErrorData *edata, int exclude_nchars, const PendingAudit *pending);
+static void pgauditlogtofile_format_audit(StringInfo buf, const ErrorData *edata, int exclude_nchars,
+                                          const PendingAudit *pending, uint64 sequence);
 static void *pgauditlogtofile_zstd_alloc(void *opaque, size_t size);
 static void pgauditlogtofile_zstd_free(void *opaque, void *address);
 
 /* public methods */
 
 /**
- * @brief Flushes any pending audit record, injecting current execution stats.
+ * @brief Flushes the audit records buffered by a statement, injecting its execution stats.
+ * @param pending: executor level with the records and stats
+ * @return void
  */
-void PgAuditLogToFile_Flush_Pending(void)
+void PgAuditLogToFile_Flush_Pending(const PendingAudit *pending)
 {
   int save_errno = errno;
+  ListCell *lc;
 
-  if (!pgaudit_ltf_pending_audit.active || pgaudit_ltf_pending_audit.edata == NULL)
+  if (pending->records == NIL)
     return;
 
-  pgauditlogtofile_record_audit(pgaudit_ltf_pending_audit.edata, PGAUDIT_PREFIX_LINE_LENGTH);
-
-  PgAuditLogToFile_FreePendingErrorData();
+  PgAuditLogToFile_wait_start(PGAUDIT_LTF_WAIT_FLUSH);
+  foreach (lc, pending->records)
+    pgauditlogtofile_record_audit((const ErrorData *)lfirst(lc), PGAUDIT_PREFIX_LINE_LENGTH, pending);
+  PgAuditLogToFile_wait_end();
 
   errno = save_errno;
 }
@@ -94,36 +109,41 @@ void PgAuditLogToFile_Flush_Pending(void)
 void PgAuditLogToFile_emit_log(ErrorData *edata)
 {
   int save_errno = errno;
+  instr_time capture_start;
 
   if (pgauditlogtofile_is_enabled())
   {
+    PgAuditLogToFile_latency_start(&capture_start);
+
     if (pg_strncasecmp(edata->message, PGAUDIT_PREFIX_LINE, PGAUDIT_PREFIX_LINE_LENGTH) == 0)
     {
-      edata->output_to_server = false;
-      if (guc_pgaudit_ltf_log_execution_time || guc_pgaudit_ltf_log_execution_memory)
-      {
-        /*
-         * If we measure execution variables,
-         * we buffer the message instead of writing it.
-         * It will be flushed in ExecutorEnd with correct timing stats.
-         */
-
-        /* free in case of strange scenarios were ExecutorEndHook is not called */
-        PgAuditLogToFile_FreePendingErrorData();
+      bool buffered;
 
-        PgAuditLogToFile_CopyPendingErrorData(edata);
-      }
-      else
+      edata->output_to_server = false;
+      /*
+       * If we measure execution variables, the message is buffered in the
+       * executor level of the statement being started. It will be flushed
+       * in its ExecutorEnd with correct stats.
+       */
+      buffered = PgAuditLogToFile_Pending_Enabled() && PgAuditLogToFile_Pending_Add(edata);
+      PgAuditLogToFile_latency_end(PGAUDIT_LTF_STAGE_CAPTURE, &capture_start);
+      if (PGAUDITLOGTOFILE_RECORD_CAPTURE_ENABLED())
+        PGAUDITLOGTOFILE_RECORD_CAPTURE(MyProcPid, strlen(edata->message), buffered);
+
+      if (!buffered)
       {
         /* we don't waste cycles on buffering */
-        pgauditlogtofile_record_audit(edata, PGAUDIT_PREFIX_LINE_LENGTH);
+        pgauditlogtofile_record_audit(edata, PGAUDIT_PREFIX_LINE_LENGTH, NULL);
       }
     }
     else if (pgauditlogtofile_is_prefixed(edata->message))
     {
       /* connections/disconnection messages, audited immediately and without execution values */
       edata->output_to_server = false;
-      pgauditlogtofile_record_audit(edata, 0);
+      PgAuditLogToFile_latency_end(PGAUDIT_LTF_STAGE_CAPTURE, &capture_start);
+      if (PGAUDITLOGTOFILE_RECORD_CAPTURE_ENABLED())
+        PGAUDITLOGTOFILE_RECORD_CAPTURE(MyProcPid, strlen(edata->message), false);
+      pgauditlogtofile_record_audit(edata, 0, NULL);
     }
   }
 
@@ -151,6 +171,7 @@ static void pgauditlogtofile_close_file(void)
   {
     close(pgaudit_ltf_file_handler);
     pgaudit_ltf_file_handler = -1;
+    PgAuditLogToFile_close_barrier_closed();
   }
 }
 
@@ -224,43 +245,78 @@ static bool pgauditlogtofile_is_prefixed(const char *msg)
  */
 static bool pgauditlogtofile_open_file(void)
 {
-  mode_t oumask;
   bool opened = false;
   char shm_filename[MAXPGPATH];
+  uint32 generation;
+  /* every process holding the file registers, except the worker that waits for them */
+  bool barrier = MyProc != NULL &&
+                 !(MyBgworkerEntry != NULL && strcmp(MyBgworkerEntry->bgw_function_name, "PgAuditLogToFileMain") == 0);
 
   if (MyProc == NULL)
   {
-    /* MyProc deinitialized, reuse filename_in_use */
+    /* MyProc deinitialized, reuse filename_in_use while it's still the current file */
     strlcpy(shm_filename, filename_in_use, MAXPGPATH);
+    PgAuditLogToFile_wait_start(PGAUDIT_LTF_WAIT_OPEN);
+    pgaudit_ltf_file_handler = pgauditlogtofile_open_current(shm_filename, pgaudit_ltf_local_rotation_generation);
+    PgAuditLogToFile_wait_end();
   }
   else
   {
-    LWLockAcquire(&pgaudit_ltf_shm->lock, LW_SHARED);
-    strlcpy(shm_filename, pgaudit_ltf_shm->filename, MAXPGPATH);
-    LWLockRelease(&pgaudit_ltf_shm->lock);
-  }
+    /* the worker can ask us to close it, handler first so the request is never lost */
+    if (barrier)
+      PgAuditLogToFile_SIGUSR1_setup();
 
-  // if the filename is empty, we short-circuit
-  if (shm_filename[0] == '\0')
-    return false;
+    for (;;)
+    {
+      int num_shards;
 
-  /* Create spool directory if not present; ignore errors */
-  (void)MakePGDirectory(guc_pgaudit_ltf_log_directory);
+      /* registered before reading the name, see logtofile_close_barrier.c */
+      generation = pg_atomic_read_u32(&pgaudit_ltf_shm->rotation_generation);
+      if (barrier)
+        PgAuditLogToFile_close_barrier_opening(generation);
+      pg_memory_barrier();
 
-  /*
-   * Note we do not let guc_pgaudit_ltf_log_file_mode disable IWUSR, since we certainly want
-   * to be able to write the files ourselves.
-   */
-  oumask = umask(
-      (mode_t)((~(guc_pgaudit_ltf_log_file_mode | S_IWUSR)) & (S_IRWXU | S_IRWXG | S_IRWXO)));
-  pgaudit_ltf_file_handler = open(shm_filename, O_CREAT | O_WRONLY | O_APPEND | PG_BINARY, guc_pgaudit_ltf_log_file_mode);
-  umask(oumask);
+      num_shards = PgAuditLogToFile_read_filename(shm_filename);
+
+      // if the filename is empty, we short-circuit
+      if (shm_filename[0] == '\0')
+      {
+        if (barrier)
+          PgAuditLogToFile_close_barrier_closed();
+        return false;
+      }
+
+      /* the same backend number keeps writing to the same shard */
+      PgAuditLogToFile_shard_filename(shm_filename, (int)(MyProc - ProcGlobal->allProcs) % num_shards, num_shards);
+
+      PgAuditLogToFile_wait_start(PGAUDIT_LTF_WAIT_OPEN);
+      pgaudit_ltf_file_handler = pgauditlogtofile_open_current(shm_filename, generation);
+      PgAuditLogToFile_wait_end();
+
+      pg_memory_barrier();
+      if (pg_atomic_read_u32(&pgaudit_ltf_shm->rotation_generation) == generation)
+        break;
+
+      /* rotated meanwhile, the name may be a retired file the worker already processed */
+      if (pgaudit_ltf_file_handler != -1)
+      {
+        close(pgaudit_ltf_file_handler);
+        pgaudit_ltf_file_handler = -1;
+      }
+    }
+
+    pgaudit_ltf_local_rotation_generation = generation;
+    if (barrier && pgaudit_ltf_file_handler == -1)
+      PgAuditLogToFile_close_barrier_closed();
+  }
 
   if (pgaudit_ltf_file_handler != -1)
   {
     opened = true;
     // File open, we update the filename we are using
     strlcpy(filename_in_use, shm_filename, MAXPGPATH);
+    PgAuditLogToFile_stats_reopen();
+    PGAUDITLOGTOFILE_REOPEN(MyProcPid, filename_in_use);
   }
   else
   {
@@ -272,66 +328,156 @@ static bool pgauditlogtofile_open_file(void)
   return opened;
 }
 
+/**
+ * @brief Opens the audit file, creating it again if it was removed and it's still the current one
+ * @param filename: audit file
+ * @param generation: rotation generation the name was read in
+ * @return int - file descriptor, -1 with errno set on failure
+ * @note A retired file is never created again: the worker may have trimmed, archived or removed it already
+ */
+static int pgauditlogtofile_open_current(const char *filename, uint32 generation)
+{
+  mode_t oumask;
+  int flags = O_WRONLY | O_APPEND | PG_BINARY;
+  int fd;
+
+  if (filename[0] == '\0')
+  {
+    errno = ENOENT;
+    return -1;
+  }
+
+  /* the worker created it before publishing it */
+  fd = pgauditlogtofile_openat(filename, flags);
+  if (fd != -1 || errno != ENOENT)
+    return fd;
+
+  pg_memory_barrier();
+  if (pg_atomic_read_u32(&pgaudit_ltf_shm->rotation_generation) != generation)
+  {
+    errno = ENOENT;
+    return -1;
+  }
+
+  /* removed since, create it again */
+  (void)MakePGDirectory(guc_pgaudit_ltf_log_directory);
+
+  /*
+   * Note we do not let guc_pgaudit_ltf_log_file_mode disable IWUSR, since we certainly want
+   * to be able to write the files ourselves.
+   */
+  oumask = umask(
+      (mode_t)((~(guc_pgaudit_ltf_log_file_mode | S_IWUSR)) & (S_IRWXU | S_IRWXG | S_IRWXO)));
+  fd = PGAUDIT_LTF_OPENAT(AT_FDCWD, filename, flags | O_CREAT, guc_pgaudit_ltf_log_file_mode);
+  umask(oumask);
+
+  return fd;
+}
+
+/**
+ * @brief Opens an existing audit file relative to the cached descriptor of its directory
+ * @param filename: audit file
+ * @param flags: open flags
+ * @return int - file descriptor, -1 with errno set on failure
+ */
+static int pgauditlogtofile_openat(const char *filename, int flags)
+{
+  const char *name = strrchr(filename, '/');
+  size_t dir_len;
+  int fd;
+
+  if (name == NULL || name == filename)
+  {
+    errno = ENOENT;
+    return -1;
+  }
+  dir_len = name - filename;
+  name++;
+
+  /* log_directory or the time pattern of the directories changed */
+  if (pgaudit_ltf_dir_fd != -1 &&
+      (strncmp(pgaudit_ltf_dir_path, filename, dir_len) != 0 || pgaudit_ltf_dir_path[dir_len] != '\0'))
+  {
+    close(pgaudit_ltf_dir_fd);
+    pgaudit_ltf_dir_fd = -1;
+  }
+
+  if (pgaudit_ltf_dir_fd == -1)
+  {
+    memcpy(pgaudit_ltf_dir_path, filename, dir_len);
+    pgaudit_ltf_dir_path[dir_len] = '\0';
+    pgaudit_ltf_dir_fd = open(pgaudit_ltf_dir_path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (pgaudit_ltf_dir_fd == -1)
+      return -1;
+  }
+
+  fd = PGAUDIT_LTF_OPENAT(pgaudit_ltf_dir_fd, name, flags, 0);
+
+  /* the directory may have been replaced, look it up again next time */
+  if (fd == -1 && errno == ENOENT)
+  {
+    int save_errno = errno;
+
+    close(pgaudit_ltf_dir_fd);
+    pgaudit_ltf_dir_fd = -1;
+    errno = save_errno;
+  }
+
+  return fd;
+}
+
 /**
  * @brief Records an audit log
  * @param edata: error data
  * @param exclude_nchars: number of characters to exclude from the message
+ * @param pending: executor level with the statement stats, NULL if there are none
  * @return bool - true if the record was written
  */
-static bool pgauditlogtofile_record_audit(const ErrorData *edata, int exclude_nchars)
+static bool pgauditlogtofile_record_audit(const ErrorData *edata, int exclude_nchars, const PendingAudit *pending)
 {
   bool rc;
-  char shm_filename[MAXPGPATH];
   uint32 current_generation;
 
   /*
    * If MyProc is NULL, we are likely in a process exit sequence. We can only
    * log if we already have a filename in use. We also cannot safely acquire
-   * LWLocks to check for rotation, so we'll just stick with the current file.
+   * LWLocks, so we only stick with the file while no rotation retired it.
    */
   if (MyProc == NULL)
   {
-    if (filename_in_use[0] == '\0')
+    /* our slot is released, the worker may be processing a retired file already */
+    if (filename_in_use[0] == '\0' ||
+        pg_atomic_read_u32(&pgaudit_ltf_shm->rotation_generation) != pgaudit_ltf_local_rotation_generation)
+    {
+      pgauditlogtofile_close_file();
       return false;
+    }
   }
   else
   {
+    /* a close request whose signal we didn't process yet, and defer the new ones until the record is written */
+    PgAuditLogToFile_close_barrier_enter();
+
     /* Check if a rotation has occurred or we haven't opened any file yet */
     current_generation = pg_atomic_read_u32(&pgaudit_ltf_shm->rotation_generation);
 
     if (current_generation != pgaudit_ltf_local_rotation_generation || filename_in_use[0] == '\0')
     {
-      pgauditlogtofile_close_file();
-
-      LWLockAcquire(&pgaudit_ltf_shm->lock, LW_SHARED);
-      strlcpy(shm_filename, pgaudit_ltf_shm->filename, MAXPGPATH);
-      LWLockRelease(&pgaudit_ltf_shm->lock);
-
-      pgaudit_ltf_local_rotation_generation = current_generation;
+      ereport(DEBUG3, (errmsg("pgauditlogtofile record audit file handler requires reopening - filename_in_use %s generation %u",
+                              filename_in_use, current_generation)));
 
-      ereport(DEBUG3, (errmsg("pgauditlogtofile record audit file handler requires reopening - shm_filename %s filename_in_use %s",
-                              shm_filename, filename_in_use)));
+      /* pgauditlogtofile_open_file takes the new generation with the name */
+      pgauditlogtofile_close_file();
     }
   }
 
-  if (!pgauditlogtofile_is_open_file() && !pgauditlogtofile_open_file())
-    return false;
-
-  rc = pgauditlogtofile_write_audit(edata, exclude_nchars);
-  pgaudit_ltf_autoclose_active_ts = (pg_time_t)time(NULL);
+  if (pgauditlogtofile_is_open_file() || pgauditlogtofile_open_file())
+    rc = pgauditlogtofile_write_audit(edata, exclude_nchars, pending);
+  else
+    rc = false;
 
-  if (guc_pgaudit_ltf_auto_close_minutes > 0)
-  {
-    // only 1 auto-close thread
-    if (pg_atomic_test_set_flag(&pgaudit_ltf_autoclose_flag_thread))
-    {
-      ereport(DEBUG3, (errmsg("pgauditlogtofile record_audit - create autoclose thread")));
-      autoclose_thread_status_debug = 1;
-      pthread_attr_init(&pgaudit_ltf_autoclose_thread_attr);
-      pthread_attr_setdetachstate(&pgaudit_ltf_autoclose_thread_attr, PTHREAD_CREATE_DETACHED);
-      pthread_create(&pgaudit_ltf_autoclose_thread, &pgaudit_ltf_autoclose_thread_attr, PgAuditLogToFile_autoclose_run, &autoclose_thread_status_debug);
-    }
-  }
+  /* safe point, publish the activity and close the file if the worker asked for it meanwhile */
+  PgAuditLogToFile_close_barrier_leave();
 
   return rc;
 }
@@ -340,15 +486,19 @@ static bool pgauditlogtofile_record_audit(const ErrorData *edata, int exclude_nc
  * @brief Writes an audit record in the audit log file
  * @param edata: error data
  * @param exclude_nchars: number of characters to exclude from the message
+ * @param pending: executor level with the statement stats, NULL if there are none
  */
-static bool pgauditlogtofile_write_audit(const ErrorData *edata, int exclude_nchars)
+static bool pgauditlogtofile_write_audit(const ErrorData *edata, int exclude_nchars, const PendingAudit *pending)
 {
   MemoryContext oldcontext;
   StringInfoData buf;
   char *data_to_write;
   size_t data_len;
-  int rc;
+  size_t written = 0;
+  ssize_t rc;
   bool success = false;
+  instr_time stage_start;
+  instr_time probe_start;
 
   oldcontext = MemoryContextSwitchTo(pgaudit_ltf_memory_context);
 #if (PG_VERSION_NUM >= 180000)
@@ -358,9 +508,15 @@ static bool pgauditlogtofile_write_audit(const ErrorData *edata, int exclude_nch
 #endif
   MemoryContextSwitchTo(oldcontext);
 
-  pgauditlogtofile_format_audit(&buf, edata, exclude_nchars);
+  PgAuditLogToFile_latency_start(&stage_start);
+  PGAUDIT_LTF_PROBE_TIMER_START(PGAUDITLOGTOFILE_FORMAT_DONE_ENABLED(), probe_start);
+  PGAUDITLOGTOFILE_FORMAT_START(MyProcPid);
+  /* taken even if the write fails, the gap tells the readers that a record is missing */
+  pgauditlogtofile_format_audit(&buf, edata, exclude_nchars, pending, PgAuditLogToFile_sequence_next());
+  PGAUDITLOGTOFILE_FORMAT_DONE(MyProcPid, (size_t)buf.len, PgAuditLogToFile_probe_elapsed(&probe_start));
+  PgAuditLogToFile_latency_end(PGAUDIT_LTF_STAGE_FORMAT, &stage_start);
 
-  // auto-close maybe has closed the file
+  // a failed write of a previous record in the same statement maybe has closed the file
   if (pgaudit_ltf_file_handler == -1)
     pgauditlogtofile_open_file();
 
@@ -372,17 +528,46 @@ static bool pgauditlogtofile_write_audit(const ErrorData *edata, int exclude_nch
     bool write_ready = true;
 
     if (guc_pgaudit_ltf_log_compression != PGAUDIT_LTF_COMPRESSION_OFF)
-      write_ready = pgauditlogtofile_compress_audit(buf.data, buf.len, &data_to_write, &data_len);
+    {
+      PgAuditLogToFile_latency_start(&stage_start);
+      PgAuditLogToFile_wait_start(PGAUDIT_LTF_WAIT_COMPRESS);
+      PGAUDIT_LTF_PROBE_TIMER_START(PGAUDITLOGTOFILE_COMPRESS_DONE_ENABLED(), probe_start);
+      PGAUDITLOGTOFILE_COMPRESS_START(MyProcPid, (size_t)buf.len);
+      write_ready = PgAuditLogToFile_compress_audit(buf.data, buf.len, &data_to_write, &data_len);
+      PGAUDITLOGTOFILE_COMPRESS_DONE(MyProcPid, (size_t)buf.len, write_ready ? data_len : 0,
+                                     PgAuditLogToFile_probe_elapsed(&probe_start));
+      PgAuditLogToFile_wait_end();
+      PgAuditLogToFile_latency_end(PGAUDIT_LTF_STAGE_COMPRESS, &stage_start);
+    }
 
     if (write_ready)
     {
-      rc = write(pgaudit_ltf_file_handler, data_to_write, data_len);
-      if (rc == (int)data_len)
+      PgAuditLogToFile_latency_start(&stage_start);
+      PgAuditLogToFile_wait_start(PGAUDIT_LTF_WAIT_WRITE);
+      PGAUDIT_LTF_PROBE_TIMER_START(PGAUDITLOGTOFILE_WRITE_DONE_ENABLED(), probe_start);
+      PGAUDITLOGTOFILE_WRITE_START(MyProcPid, data_len);
+      /* a short write is not an error, complete the record or the next one would be appended to it */
+      do
+      {
+        rc = PGAUDIT_LTF_WRITE(pgaudit_ltf_file_handler, data_to_write + written, data_len - written);
+        if (rc > 0)
+          written += rc;
+        /* interrupted by a signal before writing anything, try again */
+      } while ((rc > 0 || (rc < 0 && errno == EINTR)) && written < data_len);
+      PGAUDITLOGTOFILE_WRITE_DONE(MyProcPid, data_len, rc < 0 ? (long long)rc : (long long)written,
+                                  PgAuditLogToFile_probe_elapsed(&probe_start));
+      PgAuditLogToFile_wait_end();
+      PgAuditLogToFile_latency_end(PGAUDIT_LTF_STAGE_WRITE, &stage_start);
+      PgAuditLogToFile_add_file_bytes(written);
+      if (written == data_len)
       {
         success = true;
       }
       else
       {
+        /* if write didn't set errno, assume problem is no disk space */
+        if (rc >= 0)
+          errno = ENOSPC;
         ereport(LOG_SERVER_ONLY,
                 (errcode_for_file_access(),
                  errmsg("could not write audit log file \"%s\": %m", filename_in_use)));
@@ -391,6 +576,8 @@ static bool pgauditlogtofile_write_audit(const ErrorData *edata, int exclude_nch
     }
   }
 
+  PgAuditLogToFile_stats_write(success, buf.len, data_len);
+
   /* failed write, do it on server here because the original log record has been modified in place */
   if (!success)
     ereport(LOG_SERVER_ONLY, (errmsg("%s", buf.data)));
@@ -404,15 +591,16 @@ static bool pgauditlogtofile_write_audit(const ErrorData *edata, int exclude_nch
  * @brief Helper to format the audit record based on configuration.
  */
 static void
-pgauditlogtofile_format_audit(StringInfo buf, const ErrorData *edata, int exclude_nchars)
+pgauditlogtofile_format_audit(StringInfo buf, const ErrorData *edata, int exclude_nchars,
+                              const PendingAudit *pending, uint64 sequence)
 {
   switch (guc_pgaudit_ltf_log_format)
   {
   case PGAUDIT_LTF_FORMAT_CSV:
-    PgAuditLogToFile_csv_audit(buf, edata, exclude_nchars);
+    PgAuditLogToFile_csv_audit(buf, edata, exclude_nchars, pending, sequence);
     break;
   case PGAUDIT_LTF_FORMAT_JSON:
-    PgAuditLogToFile_json_audit(buf, edata, exclude_nchars);
+    PgAuditLogToFile_json_audit(buf, edata, exclude_nchars, pending, sequence);
     break;
   }
 }
@@ -421,8 +609,8 @@ pgauditlogtofile_format_audit(StringInfo buf, const ErrorData *edata, int exclud
  * @brief Helper to handle audit record compression.
  * Updates dst and dst_len pointers to the compressed buffer.
  */
-static bool
-pgauditlogtofile_compress_audit(const char *src, size_t src_len, char **dst, size_t *dst_len)
+bool
+PgAuditLogToFile_compress_audit(const char *src, size_t src_len, char **dst, size_t *dst_len)
 {
   size_t compressed_len_bound = 0;
   bool compression_success = true;
@@ -14,9 +14,12 @@
 
 #include <postgres.h>
 
+#include "logtofile_vars.h"
+
 /* Hook functions */
 extern void PgAuditLogToFile_emit_log(ErrorData *edata);
 
-extern void PgAuditLogToFile_Flush_Pending(void);
+extern void PgAuditLogToFile_Flush_Pending(const PendingAudit *pending);
+extern bool PgAuditLogToFile_compress_audit(const char *src, size_t src_len, char **dst, size_t *dst_len);
 
 #endif
@@ -0,0 +1,201 @@
+/*-------------------------------------------------------------------------
+ *
+ * logtofile_pending.c
+ *      Stack of pending audit records, one level per executor invocation
+ *
+ * Copyright (c) 2026, Francisco Miguel Biete Banon
+ *
+ * This code is released under the PostgreSQL licence, as given at
+ *  http://www.postgresql.org/about/licence/
+ *-------------------------------------------------------------------------
+ */
+#include "logtofile_pending.h"
+
+#include "logtofile_errordata.h"
+#include "logtofile_log.h"
+#include "logtofile_vars.h"
+#include "logtofile_wait_event.h"
+
+#include <nodes/pg_list.h>
+#include <utils/memutils.h>
+
+/* Defines */
+#define PGAUDIT_LTF_PENDING_INIT_DEPTH 8
+
+/* forward declaration private functions */
+static void pgauditlogtofile_pending_remove(int level);
+
+/* public methods */
+
+/**
+ * @brief Pushes a new executor level for a statement that is starting
+ * @param queryDesc: query descriptor owning the level
+ * @return PendingAudit * - the new level, only valid until the next push
+ */
+PendingAudit *PgAuditLogToFile_Pending_Push(QueryDesc *queryDesc)
+{
+  PendingAudit *pending;
+
+  /* arena for the copied records, reset in bulk when the stack is empty */
+  if (pgaudit_ltf_pending_context == NULL)
+    pgaudit_ltf_pending_context = AllocSetContextCreate(pgaudit_ltf_memory_context, "pgauditlogtofile pending context",
+                                                        ALLOCSET_DEFAULT_SIZES);
+
+  if (pgaudit_ltf_pending_stack == NULL)
+  {
+    pgaudit_ltf_pending_max_depth = PGAUDIT_LTF_PENDING_INIT_DEPTH;
+    pgaudit_ltf_pending_stack = (PendingAudit *)MemoryContextAlloc(pgaudit_ltf_memory_context,
+                                                                   sizeof(PendingAudit) * pgaudit_ltf_pending_max_depth);
+  }
+  else if (pgaudit_ltf_pending_depth >= pgaudit_ltf_pending_max_depth)
+  {
+    pgaudit_ltf_pending_max_depth *= 2;
+    pgaudit_ltf_pending_stack = (PendingAudit *)repalloc(pgaudit_ltf_pending_stack,
+                                                         sizeof(PendingAudit) * pgaudit_ltf_pending_max_depth);
+  }
+
+  pending = &pgaudit_ltf_pending_stack[pgaudit_ltf_pending_depth++];
+  MemSet(pending, 0, sizeof(PendingAudit));
+  pending->query_desc = queryDesc;
+  pending->subxid = GetCurrentSubTransactionId();
+  pending->records = NIL;
+
+  return pending;
+}
+
+/**
+ * @brief Finds the executor level owned by a query descriptor
+ * @param queryDesc: query descriptor
+ * @return PendingAudit * - the level or NULL if the statement is not tracked
+ */
+PendingAudit *PgAuditLogToFile_Pending_Find(QueryDesc *queryDesc)
+{
+  int i;
+
+  /* the owner is almost always at the top of the stack */
+  for (i = pgaudit_ltf_pending_depth - 1; i >= 0; i--)
+  {
+    if (pgaudit_ltf_pending_stack[i].query_desc == queryDesc)
+      return &pgaudit_ltf_pending_stack[i];
+  }
+
+  return NULL;
+}
+
+/**
+ * @brief Buffers an audit record in the statement that is being started
+ * @param edata: error data
+ * @return bool - true if the record was buffered, false if it must be written now
+ */
+bool PgAuditLogToFile_Pending_Add(ErrorData *edata)
+{
+  PendingAudit *pending;
+  MemoryContext oldcontext;
+
+  if (pgaudit_ltf_pending_depth == 0)
+    return false;
+
+  /*
+   * pgaudit emits the records of a statement during its ExecutorStart. If the
+   * top level is already running, the record comes from nested work that does
+   * not go through the executor (utility commands) and has no stats to wait for.
+   */
+  pending = &pgaudit_ltf_pending_stack[pgaudit_ltf_pending_depth - 1];
+  if (pending->running)
+    return false;
+
+  oldcontext = MemoryContextSwitchTo(pgaudit_ltf_pending_context);
+  pending->records = lappend(pending->records, PgAuditLogToFile_CopyErrorData(edata, pgaudit_ltf_pending_context));
+  MemoryContextSwitchTo(oldcontext);
+
+  return true;
+}
+
+/**
+ * @brief Flushes the records of an executor level and removes it from the stack
+ * @param pending: level to remove
+ * @return void
+ */
+void PgAuditLogToFile_Pending_Pop(PendingAudit *pending)
+{
+  int level = (int)(pending - pgaudit_ltf_pending_stack);
+
+  Assert(level >= 0 && level < pgaudit_ltf_pending_depth);
+
+  PgAuditLogToFile_Flush_Pending(pending);
+  pgauditlogtofile_pending_remove(level);
+}
+
+/**
+ * @brief Transaction callback - flushes the levels of statements that never reached ExecutorEnd
+ * @param event: transaction event
+ * @param arg: unused
+ * @return void
+ */
+void PgAuditLogToFile_Pending_XactCallback(XactEvent event, void *arg)
+{
+  if (event != XACT_EVENT_ABORT && event != XACT_EVENT_PARALLEL_ABORT)
+    return;
+
+  PgAuditLogToFile_wait_reset();
+
+  /* oldest first, keeping the emission order */
+  while (pgaudit_ltf_pending_depth > 0)
+    PgAuditLogToFile_Pending_Pop(&pgaudit_ltf_pending_stack[0]);
+}
+
+/**
+ * @brief Subtransaction callback - flushes the levels started inside an aborted subtransaction
+ * @param event: subtransaction event
+ * @param mySubid: aborted subtransaction
+ * @param parentSubid: unused
+ * @param arg: unused
+ * @return void
+ */
+void PgAuditLogToFile_Pending_SubXactCallback(SubXactEvent event, SubTransactionId mySubid,
+                                              SubTransactionId parentSubid, void *arg)
+{
+  int i = 0;
+
+  if (event != SUBXACT_EVENT_ABORT_SUB)
+    return;
+
+  while (i < pgaudit_ltf_pending_depth)
+  {
+    if (pgaudit_ltf_pending_stack[i].subxid >= mySubid)
+      PgAuditLogToFile_Pending_Pop(&pgaudit_ltf_pending_stack[i]);
+    else
+      i++;
+  }
+}
+
+/* private functions */
+
+/**
+ * @brief Releases the records of a level and compacts the stack
+ * @param level: position in the stack
+ * @return void
+ */
+static void
+pgauditlogtofile_pending_remove(int level)
+{
+  PendingAudit *pending = &pgaudit_ltf_pending_stack[level];
+  ListCell *lc;
+
+  pgaudit_ltf_pending_depth--;
+
+  if (pgaudit_ltf_pending_depth == 0)
+  {
+    /* nothing else is pending, release the whole arena at once */
+    MemoryContextReset(pgaudit_ltf_pending_context);
+    return;
+  }
+
+  /* levels below may stay alive for a long time (open portals), free what we can */
+  foreach (lc, pending->records)
+    FreeErrorData((ErrorData *)lfirst(lc));
+  list_free(pending->records);
+
+  if (level < pgaudit_ltf_pending_depth)
+    memmove(pending, pending + 1, sizeof(PendingAudit) * (pgaudit_ltf_pending_depth - level));
+}
@@ -0,0 +1,47 @@
+/*-------------------------------------------------------------------------
+ *
+ * logtofile_pending.h
+ *      Stack of pending audit records, one level per executor invocation
+ *
+ * Copyright (c) 2026, Francisco Miguel Biete Banon
+ *
+ * This code is released under the PostgreSQL licence, as given at
+ *  http://www.postgresql.org/about/licence/
+ *-------------------------------------------------------------------------
+ */
+#ifndef _LOGTOFILE_PENDING_H_
+#define _LOGTOFILE_PENDING_H_
+
+#include <postgres.h>
+#include <access/xact.h>
+#include <executor/executor.h>
+
+#include "logtofile_vars.h"
+
+/**
+ * @brief Checks if any execution value is measured, records are buffered until ExecutorEnd
+ * @return bool - true if the records need to wait for their statement stats
+ */
+static inline bool
+PgAuditLogToFile_Pending_Enabled(void)
+{
+  return guc_pgaudit_ltf_log_execution_time ||
+         guc_pgaudit_ltf_log_execution_memory ||
+         guc_pgaudit_ltf_log_execution_buffers ||
+         guc_pgaudit_ltf_log_execution_jit ||
+         guc_pgaudit_ltf_log_execution_rusage ||
+         guc_pgaudit_ltf_log_execution_parallel ||
+         guc_pgaudit_ltf_log_execution_plan_min_duration >= 0;
+}
+
+extern PendingAudit *PgAuditLogToFile_Pending_Push(QueryDesc *queryDesc);
+extern PendingAudit *PgAuditLogToFile_Pending_Find(QueryDesc *queryDesc);
+extern bool PgAuditLogToFile_Pending_Add(ErrorData *edata);
+extern void PgAuditLogToFile_Pending_Pop(PendingAudit *pending);
+
+/* Transaction callbacks */
+extern void PgAuditLogToFile_Pending_XactCallback(XactEvent event, void *arg);
+extern void PgAuditLogToFile_Pending_SubXactCallback(SubXactEvent event, SubTransactionId mySubid,
+                                                     SubTransactionId parentSubid, void *arg);
+
+#endif
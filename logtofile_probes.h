@@ -0,0 +1,117 @@
+/*-------------------------------------------------------------------------
+ *
+ * logtofile_probes.h
+ *      USDT probes of the audit write pipeline
+ *
+ * Copyright (c) 2026, Francisco Miguel Biete Banon
+ *
+ * This code is released under the PostgreSQL licence, as given at
+ *  http://www.postgresql.org/about/licence/
+ *-------------------------------------------------------------------------
+ */
+#ifndef _LOGTOFILE_PROBES_H_
+#define _LOGTOFILE_PROBES_H_
+
+#include <postgres.h>
+#include <portability/instr_time.h>
+
+#ifdef PGAUDIT_LTF_ENABLE_DTRACE
+
+/* generated from logtofile_probes.d when PostgreSQL is built with --enable-dtrace */
+#include "logtofile_probes_dtrace.h"
+
+#else
+
+/*
+ * The *_DONE probes evaluate their duration, so the timer started for it is
+ * used in every build; it's folded away since the probe is never enabled.
+ */
+#define PGAUDITLOGTOFILE_RECORD_CAPTURE(INT1, INT2, INT3) \
+  do                                                      \
+  {                                                       \
+  } while (0)
+#define PGAUDITLOGTOFILE_RECORD_CAPTURE_ENABLED() (0)
+#define PGAUDITLOGTOFILE_FORMAT_START(INT1) \
+  do                                        \
+  {                                         \
+  } while (0)
+#define PGAUDITLOGTOFILE_FORMAT_START_ENABLED() (0)
+#define PGAUDITLOGTOFILE_FORMAT_DONE(INT1, INT2, INT3) \
+  do                                                   \
+  {                                                    \
+    (void)(INT3);                                      \
+  } while (0)
+#define PGAUDITLOGTOFILE_FORMAT_DONE_ENABLED() (0)
+#define PGAUDITLOGTOFILE_COMPRESS_START(INT1, INT2) \
+  do                                                \
+  {                                                 \
+  } while (0)
+#define PGAUDITLOGTOFILE_COMPRESS_START_ENABLED() (0)
+#define PGAUDITLOGTOFILE_COMPRESS_DONE(INT1, INT2, INT3, INT4) \
+  do                                                           \
+  {                                                            \
+    (void)(INT4);                                              \
+  } while (0)
+#define PGAUDITLOGTOFILE_COMPRESS_DONE_ENABLED() (0)
+#define PGAUDITLOGTOFILE_WRITE_START(INT1, INT2) \
+  do                                             \
+  {                                              \
+  } while (0)
+#define PGAUDITLOGTOFILE_WRITE_START_ENABLED() (0)
+#define PGAUDITLOGTOFILE_WRITE_DONE(INT1, INT2, INT3, INT4) \
+  do                                                        \
+  {                                                         \
+    (void)(INT4);                                           \
+  } while (0)
+#define PGAUDITLOGTOFILE_WRITE_DONE_ENABLED() (0)
+#define PGAUDITLOGTOFILE_ROTATE(INT1, INT2) \
+  do                                        \
+  {                                         \
+  } while (0)
+#define PGAUDITLOGTOFILE_ROTATE_ENABLED() (0)
+#define PGAUDITLOGTOFILE_REOPEN(INT1, INT2) \
+  do                                        \
+  {                                         \
+  } while (0)
+#define PGAUDITLOGTOFILE_REOPEN_ENABLED() (0)
+#define PGAUDITLOGTOFILE_FILE_CLOSED(INT1, INT2) \
+  do                                             \
+  {                                              \
+  } while (0)
+#define PGAUDITLOGTOFILE_FILE_CLOSED_ENABLED() (0)
+
+#endif
+
+/* Starts the duration of a *_DONE probe, only when it is enabled */
+#define PGAUDIT_LTF_PROBE_TIMER_START(ENABLED, START) \
+  do                                                  \
+  {                                                   \
+    if (ENABLED)                                      \
+      INSTR_TIME_SET_CURRENT(START);                  \
+    else                                              \
+      INSTR_TIME_SET_ZERO(START);                     \
+  } while (0)
+
+/**
+ * @brief Duration for a *_DONE probe
+ * @param start: set by PGAUDIT_LTF_PROBE_TIMER_START
+ * @return long long - nanoseconds, 0 if the probe was not enabled at the start
+ */
+static inline long long
+PgAuditLogToFile_probe_elapsed(const instr_time *start)
+{
+  instr_time duration;
+
+  if (INSTR_TIME_IS_ZERO(*start))
+    return 0;
+
+  INSTR_TIME_SET_CURRENT(duration);
+  INSTR_TIME_SUBTRACT(duration, *start);
+#if (PG_VERSION_NUM >= 160000)
+  return (long long)INSTR_TIME_GET_NANOSEC(duration);
+#else
+  return (long long)INSTR_TIME_GET_MICROSEC(duration) * 1000;
+#endif
+}
+
+#endif
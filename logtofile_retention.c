@@ -0,0 +1,270 @@
+/*-------------------------------------------------------------------------
+ *
+ * logtofile_retention.c
+ *      Removal of old audit files, pgaudit.log_retention_age and pgaudit.log_retention_size
+ *
+ * The worker keeps a listing of the audit files of pgaudit.log_directory,
+ * the ones matching pgaudit.log_filename, oldest first. The directory is
+ * only read again when its modification time changes, i.e. when a file is
+ * created or removed; between rotations only the files in use are checked,
+ * they are the only ones that grow. Files in use, the current one and the
+ * retired ones some backend still holds open, and files waiting for the
+ * archive command are never removed. After a worker restart nothing is
+ * removed until the backends that opened a file before it are gone.
+ *
+ * Copyright (c) 2026, Francisco Miguel Biete Banon
+ *
+ * This code is released under the PostgreSQL licence, as given at
+ *  http://www.postgresql.org/about/licence/
+ *-------------------------------------------------------------------------
+ */
+#include "logtofile_retention.h"
+
+#include "logtofile_archive.h"
+#include "logtofile_retired.h"
+#include "logtofile_vars.h"
+
+#include <storage/fd.h>
+#include <utils/memutils.h>
+
+#include <fnmatch.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+typedef struct PgAuditLogToFileRetentionFile
+{
+  char filename[MAXPGPATH];
+  pg_time_t mtime;
+  uint64 size;
+  bool in_use;
+} PgAuditLogToFileRetentionFile;
+
+/* variables to use only in this unit */
+static PgAuditLogToFileRetentionFile *pgaudit_ltf_retention_files = NULL;
+static int pgaudit_ltf_retention_num_files = 0;
+static int pgaudit_ltf_retention_max_files = 0;
+/* the listing is valid for this directory and pattern, until the directory changes */
+static bool pgaudit_ltf_retention_valid = false;
+static pg_time_t pgaudit_ltf_retention_dir_mtime = 0;
+static char pgaudit_ltf_retention_directory[MAXPGPATH];
+static char pgaudit_ltf_retention_pattern[MAXPGPATH];
+
+/* forward declaration private functions */
+static void pgauditlogtofile_retention_pattern(char *pattern);
+static void pgauditlogtofile_retention_scan(void);
+static int pgauditlogtofile_retention_compare(const void *a, const void *b);
+
+/* public methods */
+
+/**
+ * @brief Removes the oldest audit files not in use past the retention age or size
+ * @param void
+ * @return long - milliseconds until the next file reaches the retention age, -1 if none
+ */
+long PgAuditLogToFile_retention_enforce(void)
+{
+  char pattern[MAXPGPATH];
+  struct stat st;
+  pg_time_t now;
+  uint64 total = 0;
+  uint64 max_size = (uint64)guc_pgaudit_ltf_log_retention_size * 1024;
+  long next_secs = -1;
+  bool reorder = false;
+  int i;
+  int kept;
+
+  if ((guc_pgaudit_ltf_log_retention_age == 0 && guc_pgaudit_ltf_log_retention_size == 0) ||
+      guc_pgaudit_ltf_log_directory == NULL || guc_pgaudit_ltf_log_directory[0] == '\0' ||
+      guc_pgaudit_ltf_log_filename == NULL || guc_pgaudit_ltf_log_filename[0] == '\0')
+  {
+    pgaudit_ltf_retention_valid = false;
+    return -1;
+  }
+
+  if (stat(guc_pgaudit_ltf_log_directory, &st) != 0)
+    return -1;
+
+  now = (pg_time_t)time(NULL);
+
+  pgauditlogtofile_retention_pattern(pattern);
+  if (!pgaudit_ltf_retention_valid || pgaudit_ltf_retention_dir_mtime != (pg_time_t)st.st_mtime ||
+      strcmp(pgaudit_ltf_retention_directory, guc_pgaudit_ltf_log_directory) != 0 ||
+      strcmp(pgaudit_ltf_retention_pattern, pattern) != 0)
+  {
+    strlcpy(pgaudit_ltf_retention_directory, guc_pgaudit_ltf_log_directory, MAXPGPATH);
+    strlcpy(pgaudit_ltf_retention_pattern, pattern, MAXPGPATH);
+    pgauditlogtofile_retention_scan();
+
+    /* a change in the same second would not change the time, trust it once that second is over */
+    pgaudit_ltf_retention_dir_mtime = (pg_time_t)st.st_mtime;
+    pgaudit_ltf_retention_valid = pgaudit_ltf_retention_dir_mtime < now;
+  }
+
+  /* only the files in use grow */
+  for (i = 0; i < pgaudit_ltf_retention_num_files; i++)
+  {
+    PgAuditLogToFileRetentionFile *file = &pgaudit_ltf_retention_files[i];
+
+    /* files retired by a previous worker are unknown, they may still be held */
+    file->in_use = PgAuditLogToFile_retired_unknown() || PgAuditLogToFile_retired_in_use(file->filename) ||
+                   PgAuditLogToFile_archive_pending(file->filename);
+    if (file->in_use && stat(file->filename, &st) == 0)
+    {
+      reorder |= file->mtime != (pg_time_t)st.st_mtime;
+      file->mtime = (pg_time_t)st.st_mtime;
+      file->size = (uint64)st.st_size;
+    }
+    total += file->size;
+  }
+
+  if (reorder)
+    qsort(pgaudit_ltf_retention_files, pgaudit_ltf_retention_num_files, sizeof(PgAuditLogToFileRetentionFile),
+          pgauditlogtofile_retention_compare);
+
+  /* oldest first */
+  kept = 0;
+  for (i = 0; i < pgaudit_ltf_retention_num_files; i++)
+  {
+    PgAuditLogToFileRetentionFile *file = &pgaudit_ltf_retention_files[i];
+    bool expired = guc_pgaudit_ltf_log_retention_age > 0 && now - file->mtime >= guc_pgaudit_ltf_log_retention_age;
+    bool over_size = max_size > 0 && total > max_size;
+
+    if (!file->in_use && (expired || over_size))
+    {
+      if (unlink(file->filename) == 0 || errno == ENOENT)
+      {
+        ereport(LOG, (errmsg("pgauditlogtofile bgw: removed audit file \"%s\" (%s)", file->filename,
+                             expired ? "pgaudit.log_retention_age" : "pgaudit.log_retention_size")));
+        PgAuditLogToFile_archive_forget(file->filename);
+        total -= file->size;
+        continue;
+      }
+
+      ereport(LOG, (errcode_for_file_access(),
+                    errmsg("pgauditlogtofile could not remove audit file \"%s\": %m", file->filename)));
+    }
+    else if (!file->in_use && guc_pgaudit_ltf_log_retention_age > 0 &&
+             (next_secs < 0 || file->mtime + guc_pgaudit_ltf_log_retention_age - now < next_secs))
+      next_secs = (long)(file->mtime + guc_pgaudit_ltf_log_retention_age - now);
+
+    if (kept != i)
+      pgaudit_ltf_retention_files[kept] = *file;
+    kept++;
+  }
+  pgaudit_ltf_retention_num_files = kept;
+
+  if (next_secs < 0)
+    return -1;
+
+  return Min(next_secs, SECS_PER_DAY) * 1000L;
+}
+
+/* private functions */
+
+/**
+ * @brief Pattern for fnmatch of the names pgaudit.log_filename expands to
+ * @param pattern: buffer of MAXPGPATH bytes
+ * @return void
+ * @note Every strftime escape matches anything, and anything can follow for the size, shard and compression suffixes
+ */
+static void
+pgauditlogtofile_retention_pattern(char *pattern)
+{
+  const char *p;
+  int len = 0;
+
+  for (p = guc_pgaudit_ltf_log_filename; *p != '\0' && len < MAXPGPATH - 3; p++)
+  {
+    if (*p == '%' && p[1] == '%')
+    {
+      pattern[len++] = '%';
+      p++;
+    }
+    else if (*p == '%' && p[1] != '\0')
+    {
+      if (len == 0 || pattern[len - 1] != '*')
+        pattern[len++] = '*';
+      p++;
+    }
+    else
+    {
+      if (*p == '*' || *p == '?' || *p == '[' || *p == '\\')
+        pattern[len++] = '\\';
+      pattern[len++] = *p;
+    }
+  }
+
+  pattern[len++] = '*';
+  pattern[len] = '\0';
+}
+
+/**
+ * @brief Lists the audit files of the directory, oldest first
+ * @param void
+ * @return void
+ */
+static void
+pgauditlogtofile_retention_scan(void)
+{
+  DIR *dir;
+  struct dirent *de;
+  struct stat st;
+  char filename[MAXPGPATH];
+
+  pgaudit_ltf_retention_num_files = 0;
+
+  dir = AllocateDir(pgaudit_ltf_retention_directory);
+  while ((de = ReadDirExtended(dir, pgaudit_ltf_retention_directory, LOG)) != NULL)
+  {
+    PgAuditLogToFileRetentionFile *file;
+
+    if (fnmatch(pgaudit_ltf_retention_pattern, de->d_name, 0) != 0)
+      continue;
+
+    pg_snprintf(filename, MAXPGPATH, "%s/%s", pgaudit_ltf_retention_directory, de->d_name);
+    if (lstat(filename, &st) != 0 || !S_ISREG(st.st_mode))
+      continue;
+
+    /* survives the loop context of the worker */
+    if (pgaudit_ltf_retention_num_files == pgaudit_ltf_retention_max_files)
+    {
+      pgaudit_ltf_retention_max_files = Max(pgaudit_ltf_retention_max_files * 2, 64);
+      if (pgaudit_ltf_retention_files == NULL)
+        pgaudit_ltf_retention_files = (PgAuditLogToFileRetentionFile *)MemoryContextAlloc(
+            pgaudit_ltf_memory_context, pgaudit_ltf_retention_max_files * sizeof(PgAuditLogToFileRetentionFile));
+      else
+        pgaudit_ltf_retention_files = (PgAuditLogToFileRetentionFile *)repalloc(
+            pgaudit_ltf_retention_files, pgaudit_ltf_retention_max_files * sizeof(PgAuditLogToFileRetentionFile));
+    }
+
+    file = &pgaudit_ltf_retention_files[pgaudit_ltf_retention_num_files++];
+    strlcpy(file->filename, filename, MAXPGPATH);
+    file->mtime = (pg_time_t)st.st_mtime;
+    file->size = (uint64)st.st_size;
+    file->in_use = false;
+  }
+  FreeDir(dir);
+
+  if (pgaudit_ltf_retention_num_files > 1)
+    qsort(pgaudit_ltf_retention_files, pgaudit_ltf_retention_num_files, sizeof(PgAuditLogToFileRetentionFile),
+          pgauditlogtofile_retention_compare);
+
+  ereport(DEBUG3, (errmsg("pgauditlogtofile bgw: %d audit files in \"%s\"", pgaudit_ltf_retention_num_files,
+                          pgaudit_ltf_retention_directory)));
+}
+
+/**
+ * @brief qsort comparator, by modification time and name
+ */
+static int
+pgauditlogtofile_retention_compare(const void *a, const void *b)
+{
+  const PgAuditLogToFileRetentionFile *fa = (const PgAuditLogToFileRetentionFile *)a;
+  const PgAuditLogToFileRetentionFile *fb = (const PgAuditLogToFileRetentionFile *)b;
+
+  if (fa->mtime != fb->mtime)
+    return fa->mtime < fb->mtime ? -1 : 1;
+
+  return strcmp(fa->filename, fb->filename);
+}
@@ -1,7 +1,7 @@
 /*-------------------------------------------------------------------------
  *
- * logtofile_urgentclose.h
- *      Functions to close the audit file descriptor immediately - async-safe
+ * logtofile_retention.h
+ *      Removal of old audit files, pgaudit.log_retention_age and pgaudit.log_retention_size
  *
  * Copyright (c) 2026, Francisco Miguel Biete Banon
  *
@@ -9,12 +9,12 @@
  *  http://www.postgresql.org/about/licence/
  *-------------------------------------------------------------------------
  */
-#ifndef _LOGTOFILE_URGENTCLOSE_H_
-#define _LOGTOFILE_URGENTCLOSE_H_
+#ifndef _LOGTOFILE_RETENTION_H_
+#define _LOGTOFILE_RETENTION_H_
 
 #include <postgres.h>
 
-/* Async-Safe Signal Handler */
-extern void PgAuditLogToFile_close_file_urgent(void);
+/* Background worker */
+extern long PgAuditLogToFile_retention_enforce(void);
 
 #endif
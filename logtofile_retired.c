@@ -0,0 +1,282 @@
+/*-------------------------------------------------------------------------
+ *
+ * logtofile_retired.c
+ *      Audit files retired by a rotation, until every backend closes them
+ *
+ * A rotation only bumps rotation_generation, the backends reopen lazily on
+ * their next record, so idle ones can keep the previous file open for hours.
+ * The worker remembers every retired file with the last generation that
+ * wrote to it and counts the backend slots still registering that
+ * generation or an older one. When the count drops to zero the file is
+ * complete and the "file closed" actions run on it.
+ *
+ * The list lives in the worker memory. A restarted worker doesn't know the
+ * files retired by the previous one, so until every backend that opened a
+ * file before it started is gone, any file may still be in use.
+ *
+ * Copyright (c) 2026, Francisco Miguel Biete Banon
+ *
+ * This code is released under the PostgreSQL licence, as given at
+ *  http://www.postgresql.org/about/licence/
+ *-------------------------------------------------------------------------
+ */
+#include "logtofile_retired.h"
+
+#include "logtofile_close_barrier.h"
+#include "logtofile_filename.h"
+#include "logtofile_probes.h"
+#include "logtofile_vars.h"
+
+#include <miscadmin.h>
+#include <nodes/pg_list.h>
+#include <utils/memutils.h>
+#include <utils/timestamp.h>
+
+/* Defines */
+#define PGAUDIT_LTF_RETIRED_MAX_ACTIONS 8
+
+typedef struct PgAuditLogToFileRetired
+{
+  uint32 generation;
+  char filename[MAXPGPATH];
+  int num_shards;
+  TimestampTz retired_at;
+  bool nudged;
+} PgAuditLogToFileRetired;
+
+/* variables to use only in this unit */
+static List *pgaudit_ltf_retired = NIL;
+static PgAuditLogToFileClosedAction pgaudit_ltf_retired_actions[PGAUDIT_LTF_RETIRED_MAX_ACTIONS];
+static int pgaudit_ltf_retired_num_actions = 0;
+/* holders of files retired before the worker started, unknown until they are gone */
+static bool pgaudit_ltf_retired_unknown = false;
+static uint32 pgaudit_ltf_retired_unknown_generation = 0;
+static TimestampTz pgaudit_ltf_retired_started_at = 0;
+static bool pgaudit_ltf_retired_unknown_nudged = false;
+
+/* forward declaration private functions */
+static void pgauditlogtofile_retired_closed(const PgAuditLogToFileRetired *retired);
+static bool pgauditlogtofile_retired_is_shard(const char *filename, const char *name, int num_shards);
+
+/* public methods */
+
+/**
+ * @brief Registers an action to run on every retired file once it's closed by all backends
+ * @param action: function receiving the file name
+ * @return void
+ */
+void PgAuditLogToFile_retired_register_action(PgAuditLogToFileClosedAction action)
+{
+  if (pgaudit_ltf_retired_num_actions >= PGAUDIT_LTF_RETIRED_MAX_ACTIONS)
+    ereport(ERROR, (errmsg("pgauditlogtofile too many file closed actions")));
+
+  pgaudit_ltf_retired_actions[pgaudit_ltf_retired_num_actions++] = action;
+}
+
+/**
+ * @brief Takes note of the backends that opened a file before the worker started
+ * @param void
+ * @return void
+ * @note Nobody opened one yet when the server starts, the first PgAuditLogToFile_retired_process forgets them
+ */
+void PgAuditLogToFile_retired_startup(void)
+{
+  /* wraparound-aware, every generation before the current one */
+  pgaudit_ltf_retired_unknown_generation = pg_atomic_read_u32(&pgaudit_ltf_shm->rotation_generation) - 1;
+  pgaudit_ltf_retired_started_at = GetCurrentTimestamp();
+  pgaudit_ltf_retired_unknown_nudged = false;
+  pgaudit_ltf_retired_unknown = true;
+}
+
+/**
+ * @brief Remembers a file retired by a rotation
+ * @param generation: last rotation generation that used the file
+ * @param filename: retired file
+ * @param num_shards: number of shards of the file
+ * @return void
+ */
+void PgAuditLogToFile_retired_add(uint32 generation, const char *filename, int num_shards)
+{
+  MemoryContext old_context;
+  PgAuditLogToFileRetired *retired;
+  ListCell *lc;
+
+  /* the file can be retired again after coming back, e.g. a reload to a previous log_filename */
+  foreach (lc, pgaudit_ltf_retired)
+  {
+    retired = (PgAuditLogToFileRetired *)lfirst(lc);
+    if (strcmp(retired->filename, filename) == 0)
+    {
+      retired->generation = generation;
+      retired->num_shards = Max(retired->num_shards, num_shards);
+      retired->retired_at = GetCurrentTimestamp();
+      retired->nudged = false;
+      return;
+    }
+  }
+
+  /* survives the loop context of the worker */
+  old_context = MemoryContextSwitchTo(pgaudit_ltf_memory_context);
+  retired = (PgAuditLogToFileRetired *)palloc0(sizeof(PgAuditLogToFileRetired));
+  retired->generation = generation;
+  strlcpy(retired->filename, filename, MAXPGPATH);
+  retired->num_shards = num_shards;
+  retired->retired_at = GetCurrentTimestamp();
+  pgaudit_ltf_retired = lappend(pgaudit_ltf_retired, retired);
+  MemoryContextSwitchTo(old_context);
+
+  ereport(DEBUG3, (errmsg("pgauditlogtofile retired file %s generation %u", filename, generation)));
+}
+
+/**
+ * @brief Runs the file closed actions of the retired files without holders
+ * @param void
+ * @return int - number of retired files still held open by some backend
+ */
+int PgAuditLogToFile_retired_process(void)
+{
+  char current_filename[MAXPGPATH];
+  ListCell *lc;
+
+  if (pgaudit_ltf_retired_unknown)
+  {
+    bool nudge = !pgaudit_ltf_retired_unknown_nudged && guc_pgaudit_ltf_log_rotation_nudge_delay >= 0 &&
+                 TimestampDifferenceExceeds(pgaudit_ltf_retired_started_at, GetCurrentTimestamp(),
+                                            guc_pgaudit_ltf_log_rotation_nudge_delay * 1000);
+
+    if (PgAuditLogToFile_close_barrier_holders(pgaudit_ltf_retired_unknown_generation, nudge) == 0)
+      pgaudit_ltf_retired_unknown = false;
+    else if (nudge)
+      pgaudit_ltf_retired_unknown_nudged = true;
+  }
+
+  if (pgaudit_ltf_retired == NIL)
+    return pgaudit_ltf_retired_unknown ? 1 : 0;
+
+  /* the worker is the only writer */
+  strlcpy(current_filename, pgaudit_ltf_shm->filename, MAXPGPATH);
+
+  foreach (lc, pgaudit_ltf_retired)
+  {
+    PgAuditLogToFileRetired *retired = (PgAuditLogToFileRetired *)lfirst(lc);
+    bool nudge = false;
+
+    /* in use again, it will be retired by a later rotation */
+    if (strcmp(retired->filename, current_filename) == 0 && retired->num_shards == pgaudit_ltf_shm->num_shards)
+    {
+      pgaudit_ltf_retired = foreach_delete_current(pgaudit_ltf_retired, lc);
+      pfree(retired);
+      continue;
+    }
+
+    if (!retired->nudged && guc_pgaudit_ltf_log_rotation_nudge_delay >= 0 &&
+        TimestampDifferenceExceeds(retired->retired_at, GetCurrentTimestamp(),
+                                   guc_pgaudit_ltf_log_rotation_nudge_delay * 1000))
+      nudge = true;
+
+    if (PgAuditLogToFile_close_barrier_holders(retired->generation, nudge) > 0)
+    {
+      /* once is enough, the backends close it at their next safe point */
+      if (nudge)
+      {
+        ereport(DEBUG1, (errmsg("pgauditlogtofile bgw: nudged the backends holding %s", retired->filename)));
+        retired->nudged = true;
+      }
+      continue;
+    }
+
+    pgauditlogtofile_retired_closed(retired);
+    pgaudit_ltf_retired = foreach_delete_current(pgaudit_ltf_retired, lc);
+    pfree(retired);
+  }
+
+  return list_length(pgaudit_ltf_retired) + (pgaudit_ltf_retired_unknown ? 1 : 0);
+}
+
+/**
+ * @brief Checks if backends can still write to a file: the current one, or a retired one not closed yet
+ * @param filename: file, with the directory
+ * @return bool - true if the file is in use
+ */
+bool PgAuditLogToFile_retired_in_use(const char *filename)
+{
+  ListCell *lc;
+
+  /* the worker is the only writer */
+  if (pgauditlogtofile_retired_is_shard(pgaudit_ltf_shm->filename, filename, pgaudit_ltf_shm->num_shards))
+    return true;
+
+  foreach (lc, pgaudit_ltf_retired)
+  {
+    PgAuditLogToFileRetired *retired = (PgAuditLogToFileRetired *)lfirst(lc);
+
+    if (pgauditlogtofile_retired_is_shard(retired->filename, filename, retired->num_shards))
+      return true;
+  }
+
+  return false;
+}
+
+/**
+ * @brief Checks if backends that opened a file before the worker started may still hold it
+ * @param void
+ * @return bool - true while any file may be in use without being known
+ */
+bool PgAuditLogToFile_retired_unknown(void)
+{
+  return pgaudit_ltf_retired_unknown;
+}
+
+/* private functions */
+
+/**
+ * @brief Runs the file closed actions on every shard
+ * @param retired: retired file without holders
+ * @return void
+ */
+static void
+pgauditlogtofile_retired_closed(const PgAuditLogToFileRetired *retired)
+{
+  char filename[MAXPGPATH];
+  int shard;
+  int i;
+
+  for (shard = 0; shard < retired->num_shards; shard++)
+  {
+    strlcpy(filename, retired->filename, MAXPGPATH);
+    PgAuditLogToFile_shard_filename(filename, shard, retired->num_shards);
+
+    ereport(LOG, (errmsg("pgauditlogtofile bgw: audit file \"%s\" closed by all backends", filename)));
+    PGAUDITLOGTOFILE_FILE_CLOSED(MyProcPid, filename);
+
+    for (i = 0; i < pgaudit_ltf_retired_num_actions; i++)
+      pgaudit_ltf_retired_actions[i](filename);
+  }
+}
+
+/**
+ * @brief Checks if a file is one of the shards of an audit file
+ * @param filename: audit file
+ * @param name: file to check
+ * @param num_shards: number of shards of the audit file
+ * @return bool - true if it's one of them
+ */
+static bool
+pgauditlogtofile_retired_is_shard(const char *filename, const char *name, int num_shards)
+{
+  char shard_filename[MAXPGPATH];
+  int shard;
+
+  if (filename[0] == '\0')
+    return false;
+
+  for (shard = 0; shard < num_shards; shard++)
+  {
+    strlcpy(shard_filename, filename, MAXPGPATH);
+    PgAuditLogToFile_shard_filename(shard_filename, shard, num_shards);
+    if (strcmp(shard_filename, name) == 0)
+      return true;
+  }
+
+  return false;
+}
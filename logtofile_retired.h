@@ -0,0 +1,28 @@
+/*-------------------------------------------------------------------------
+ *
+ * logtofile_retired.h
+ *      Audit files retired by a rotation, until every backend closes them
+ *
+ * Copyright (c) 2026, Francisco Miguel Biete Banon
+ *
+ * This code is released under the PostgreSQL licence, as given at
+ *  http://www.postgresql.org/about/licence/
+ *-------------------------------------------------------------------------
+ */
+#ifndef _LOGTOFILE_RETIRED_H_
+#define _LOGTOFILE_RETIRED_H_
+
+#include <postgres.h>
+
+/* Runs in the background worker once no backend holds the file open */
+typedef void (*PgAuditLogToFileClosedAction)(const char *filename);
+
+/* Background worker */
+extern void PgAuditLogToFile_retired_register_action(PgAuditLogToFileClosedAction action);
+extern void PgAuditLogToFile_retired_startup(void);
+extern void PgAuditLogToFile_retired_add(uint32 generation, const char *filename, int num_shards);
+extern int PgAuditLogToFile_retired_process(void);
+extern bool PgAuditLogToFile_retired_in_use(const char *filename);
+extern bool PgAuditLogToFile_retired_unknown(void);
+
+#endif
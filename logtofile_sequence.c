@@ -0,0 +1,191 @@
+/*-------------------------------------------------------------------------
+ *
+ * logtofile_sequence.c
+ *      Sequence number of the audit records, kept across restarts
+ *
+ * The counter lives in shared memory. Like the sequences of the server, the
+ * state file holds a value ahead of the numbers handed out, so they never
+ * go back after a crash: the postmaster loads it at startup and reserves a
+ * first range, the worker moves the reservation ahead when half of it is
+ * used, and a clean shutdown saves the exact value. After a crash the
+ * numbers jump to the end of the last reservation.
+ *
+ * Copyright (c) 2026, Francisco Miguel Biete Banon
+ *
+ * This code is released under the PostgreSQL licence, as given at
+ *  http://www.postgresql.org/about/licence/
+ *-------------------------------------------------------------------------
+ */
+#include "logtofile_sequence.h"
+
+#include "logtofile_vars.h"
+
+#include <storage/fd.h>
+#include <storage/latch.h>
+#include <storage/pg_shmem.h>
+
+#include <unistd.h>
+
+/* Defines */
+#define PGAUDIT_LTF_SEQUENCE_FILE "pg_stat/pgauditlogtofile.sequence"
+#define PGAUDIT_LTF_SEQUENCE_MAGIC 0x4C544653
+/* numbers handed out ahead of the state file, the most a crash can skip */
+#define PGAUDIT_LTF_SEQUENCE_RESERVE ((uint64)1 << 20)
+
+/* forward declaration private functions */
+static uint64 pgauditlogtofile_sequence_load(void);
+static bool pgauditlogtofile_sequence_save(uint64 value);
+
+/**
+ * @brief Loads the sequence of the previous run and reserves the first range
+ * @param void
+ * @return void
+ * @note Called by the postmaster while it initializes the shared memory
+ */
+void PgAuditLogToFile_sequence_startup(void)
+{
+  uint64 value = pgauditlogtofile_sequence_load();
+
+  pg_atomic_write_u64(&pgaudit_ltf_shm->record_sequence, value);
+  pgaudit_ltf_shm->sequence_reserved = value;
+
+  /* the worker keeps moving it ahead, without it the numbers of this run could repeat after a crash */
+  if (pgauditlogtofile_sequence_save(value + PGAUDIT_LTF_SEQUENCE_RESERVE))
+    pgaudit_ltf_shm->sequence_reserved = value + PGAUDIT_LTF_SEQUENCE_RESERVE;
+}
+
+/**
+ * @brief Saves the last sequence number handed out
+ * @param code: exit code of the postmaster
+ * @return void
+ * @note Called by the postmaster at exit, after every backend is gone. A crash keeps the reservation.
+ */
+void PgAuditLogToFile_sequence_shutdown(int code)
+{
+  if (code != 0 || pgaudit_ltf_shm == NULL)
+    return;
+
+  (void)pgauditlogtofile_sequence_save(pg_atomic_read_u64(&pgaudit_ltf_shm->record_sequence));
+}
+
+/**
+ * @brief Takes the sequence number of the next audit record
+ * @param void
+ * @return uint64 - sequence number, starting at 1, 0 without shared memory
+ */
+uint64 PgAuditLogToFile_sequence_next(void)
+{
+  uint64 sequence;
+  Latch *worker_latch;
+
+  if (UsedShmemSegAddr == NULL || pgaudit_ltf_shm == NULL)
+    return 0;
+
+  sequence = pg_atomic_add_fetch_u64(&pgaudit_ltf_shm->record_sequence, 1);
+
+  /* a single backend gets each half of a reservation, it wakes the worker to move it ahead */
+  if (sequence % (PGAUDIT_LTF_SEQUENCE_RESERVE / 2) == 0)
+  {
+    worker_latch = pgaudit_ltf_shm->worker_latch;
+    if (worker_latch != NULL)
+      SetLatch(worker_latch);
+  }
+
+  return sequence;
+}
+
+/**
+ * @brief Moves the reservation ahead when half of it is used
+ * @param void
+ * @return void
+ */
+void PgAuditLogToFile_sequence_reserve(void)
+{
+  uint64 sequence = pg_atomic_read_u64(&pgaudit_ltf_shm->record_sequence);
+
+  if (sequence + PGAUDIT_LTF_SEQUENCE_RESERVE / 2 <= pgaudit_ltf_shm->sequence_reserved)
+    return;
+
+  if (sequence > pgaudit_ltf_shm->sequence_reserved)
+    ereport(LOG, (errmsg("pgauditlogtofile audit record sequence %llu went past the reservation %llu",
+                         (unsigned long long)sequence,
+                         (unsigned long long)pgaudit_ltf_shm->sequence_reserved),
+                  errdetail("Sequence numbers could repeat after a crash.")));
+
+  /* retried the next time we are woken up */
+  if (pgauditlogtofile_sequence_save(sequence + PGAUDIT_LTF_SEQUENCE_RESERVE))
+    pgaudit_ltf_shm->sequence_reserved = sequence + PGAUDIT_LTF_SEQUENCE_RESERVE;
+}
+
+/* private functions */
+
+/**
+ * @brief Reads the state file
+ * @param void
+ * @return uint64 - saved value, 0 if there is none
+ */
+static uint64
+pgauditlogtofile_sequence_load(void)
+{
+  FILE *file;
+  uint32 magic = 0;
+  uint64 value = 0;
+
+  file = AllocateFile(PGAUDIT_LTF_SEQUENCE_FILE, PG_BINARY_R);
+  if (file == NULL)
+  {
+    if (errno != ENOENT)
+      ereport(LOG, (errcode_for_file_access(),
+                    errmsg("pgauditlogtofile could not read file \"%s\": %m", PGAUDIT_LTF_SEQUENCE_FILE)));
+    return 0;
+  }
+
+  if (fread(&magic, sizeof(magic), 1, file) != 1 || magic != PGAUDIT_LTF_SEQUENCE_MAGIC ||
+      fread(&value, sizeof(value), 1, file) != 1)
+  {
+    ereport(LOG, (errmsg("pgauditlogtofile ignoring invalid file \"%s\", the audit record sequence starts again",
+                         PGAUDIT_LTF_SEQUENCE_FILE)));
+    value = 0;
+  }
+
+  FreeFile(file);
+
+  return value;
+}
+
+/**
+ * @brief Replaces the state file, durably
+ * @param value: value to save
+ * @return bool - true if saved
+ */
+static bool
+pgauditlogtofile_sequence_save(uint64 value)
+{
+  FILE *file;
+  uint32 magic = PGAUDIT_LTF_SEQUENCE_MAGIC;
+
+  file = AllocateFile(PGAUDIT_LTF_SEQUENCE_FILE ".tmp", PG_BINARY_W);
+  if (file == NULL)
+    goto error;
+
+  if (fwrite(&magic, sizeof(magic), 1, file) != 1 || fwrite(&value, sizeof(value), 1, file) != 1)
+    goto error;
+
+  if (FreeFile(file))
+  {
+    file = NULL;
+    goto error;
+  }
+
+  /* fsyncs the file and the directory */
+  return durable_rename(PGAUDIT_LTF_SEQUENCE_FILE ".tmp", PGAUDIT_LTF_SEQUENCE_FILE, LOG) == 0;
+
+error:
+  ereport(LOG, (errcode_for_file_access(),
+                errmsg("pgauditlogtofile could not write file \"%s\": %m", PGAUDIT_LTF_SEQUENCE_FILE ".tmp")));
+  if (file)
+    FreeFile(file);
+  unlink(PGAUDIT_LTF_SEQUENCE_FILE ".tmp");
+
+  return false;
+}
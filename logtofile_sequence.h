@@ -0,0 +1,27 @@
+/*-------------------------------------------------------------------------
+ *
+ * logtofile_sequence.h
+ *      Sequence number of the audit records, kept across restarts
+ *
+ * Copyright (c) 2026, Francisco Miguel Biete Banon
+ *
+ * This code is released under the PostgreSQL licence, as given at
+ *  http://www.postgresql.org/about/licence/
+ *-------------------------------------------------------------------------
+ */
+#ifndef _LOGTOFILE_SEQUENCE_H_
+#define _LOGTOFILE_SEQUENCE_H_
+
+#include <postgres.h>
+
+/* Postmaster */
+extern void PgAuditLogToFile_sequence_startup(void);
+extern void PgAuditLogToFile_sequence_shutdown(int code);
+
+/* Backends */
+extern uint64 PgAuditLogToFile_sequence_next(void);
+
+/* Background worker */
+extern void PgAuditLogToFile_sequence_reserve(void);
+
+#endif
@@ -12,16 +12,24 @@
 #include "logtofile_shmem.h"
 
 #include <miscadmin.h>
+#include <postmaster/autovacuum.h>
+#include <replication/walsender.h>
+#include <storage/latch.h>
 #include <storage/pg_shmem.h>
+#include <storage/proc.h>
 #include <storage/shmem.h>
 #include <utils/memutils.h>
 #include <utils/timestamp.h>
 
+#include <sys/stat.h>
 #include <time.h>
 
+#include "logtofile_archive.h"
 #include "logtofile_connect.h"
 #include "logtofile_filename.h"
 #include "logtofile_guc.h"
+#include "logtofile_latency.h"
+#include "logtofile_sequence.h"
 #include "logtofile_vars.h"
 
 /* Extracted from src/backend/po */
@@ -61,11 +69,16 @@ static const char *postgresDisconnMsg[] = {
     "disconnection: session time: %d:%02d:%02d.%03d user=%s database=%s host=%s%s%s"};
 
 /* forward declaration private functions */
-static void pgauditlogtofile_init_prefixes(const char **messages,
+static void pgauditlogtofile_init_prefixes(PgAuditLogToFileShm *shm,
+                                           void *(*alloc_fn)(Size size),
+                                           const char **messages,
                                            size_t num_messages,
                                            PgAuditLogToFilePrefixType type);
 static size_t pgauditlogtofile_shm_main_struct_size(void);
 static size_t pgauditlogtofile_shmem_size(void);
+static int pgauditlogtofile_max_backends(void);
+static void pgauditlogtofile_write_filename(const char *filename, int num_shards);
+static uint64 pgauditlogtofile_file_size(const char *filename, int num_shards);
 
 /**
  * @brief Request shared memory space
@@ -99,6 +112,7 @@ void PgAuditLogToFile_shmem_startup(void)
   if (!found)
   {
     LWLockPadded *tranche;
+    int i;
     size_t conn_count = sizeof(postgresConnMsg) / sizeof(char *);
     size_t disconn_count = sizeof(postgresDisconnMsg) / sizeof(char *);
 
@@ -106,8 +120,10 @@ void PgAuditLogToFile_shmem_startup(void)
 
     pgaudit_ltf_shm->num_prefixes = 0;
 
-    pgauditlogtofile_init_prefixes(postgresConnMsg, conn_count, PGAUDIT_LTF_TYPE_CONNECTION);
-    pgauditlogtofile_init_prefixes(postgresDisconnMsg, disconn_count, PGAUDIT_LTF_TYPE_DISCONNECTION);
+    pgauditlogtofile_init_prefixes(pgaudit_ltf_shm, ShmemAlloc, postgresConnMsg, conn_count,
+                                   PGAUDIT_LTF_TYPE_CONNECTION);
+    pgauditlogtofile_init_prefixes(pgaudit_ltf_shm, ShmemAlloc, postgresDisconnMsg, disconn_count,
+                                   PGAUDIT_LTF_TYPE_DISCONNECTION);
 
     /*
      * Get the tranche ID from the named tranche we requested and
@@ -117,6 +133,48 @@ void PgAuditLogToFile_shmem_startup(void)
     LWLockInitialize(&pgaudit_ltf_shm->lock, tranche->lock.tranche);
 
     pg_atomic_init_u32(&pgaudit_ltf_shm->rotation_generation, 0);
+    pg_atomic_init_u32(&pgaudit_ltf_shm->filename_changecount, 0);
+
+    /* ShmemAlloc aligns to cache lines, like the padded slots */
+    pgaudit_ltf_shm->num_backends = pgauditlogtofile_max_backends();
+    pgaudit_ltf_shm->backends = (PgAuditLogToFileBackendPadded *)ShmemAlloc(
+        mul_size(pgaudit_ltf_shm->num_backends, sizeof(PgAuditLogToFileBackendPadded)));
+    for (i = 0; i < pgaudit_ltf_shm->num_backends; i++)
+    {
+      PgAuditLogToFileBackend *backend = &pgaudit_ltf_shm->backends[i].slot;
+
+      pg_atomic_init_u64(&backend->parallel_workers, 0);
+      pg_atomic_init_u64(&backend->parallel_memory, 0);
+      pg_atomic_init_u64(&backend->parallel_cpu_usec, 0);
+      backend->stats_pid = 0;
+      memset(&backend->stats, 0, sizeof(PgAuditLogToFileStats));
+      pg_atomic_init_u32(&backend->fd_open, 0);
+      pg_atomic_init_u32(&backend->open_generation, 0);
+      pg_atomic_init_u64(&backend->close_ack, 0);
+      pg_atomic_init_u64(&backend->last_write, 0);
+      pg_atomic_init_u32(&backend->idle_close, 0);
+    }
+
+    pg_atomic_init_u64(&pgaudit_ltf_shm->stats_records, 0);
+    pg_atomic_init_u64(&pgaudit_ltf_shm->stats_bytes_formatted, 0);
+    pg_atomic_init_u64(&pgaudit_ltf_shm->stats_bytes_written, 0);
+    pg_atomic_init_u64(&pgaudit_ltf_shm->stats_write_failures, 0);
+    pg_atomic_init_u64(&pgaudit_ltf_shm->stats_reopens, 0);
+    memset(&pgaudit_ltf_shm->archive_stats, 0, sizeof(PgAuditLogToFileArchiveStats));
+
+    PgAuditLogToFile_latency_shmem_init(pgaudit_ltf_shm->num_backends);
+
+    pg_atomic_init_u64(&pgaudit_ltf_shm->close_generation, 0);
+    pgaudit_ltf_shm->worker_latch = NULL;
+
+    pg_atomic_init_u64(&pgaudit_ltf_shm->record_sequence, 0);
+    PgAuditLogToFile_sequence_startup();
+
+    pg_atomic_init_u64(&pgaudit_ltf_shm->file_bytes, 0);
+    pgaudit_ltf_shm->num_shards = 1;
+    pgaudit_ltf_shm->filename_base[0] = '\0';
+    pgaudit_ltf_shm->file_sequence = 0;
+
     PgAuditLogToFile_calculate_current_filename();
     PgAuditLogToFile_set_next_rotation_time();
   }
@@ -136,6 +194,8 @@ void PgAuditLogToFile_shmem_startup(void)
  */
 void PgAuditLogToFile_shmem_shutdown(int code, Datum arg)
 {
+  PgAuditLogToFile_sequence_shutdown(code);
+  PgAuditLogToFile_archive_shutdown(code);
   pg_atomic_test_set_flag(&pgaudit_ltf_flag_shutdown);
 }
 
@@ -143,24 +203,66 @@ void PgAuditLogToFile_shmem_shutdown(int code, Datum arg)
  * @brief Generates the name for the audit log file
  * @param void
  * @return void
+ * @note Only called by the postmaster at startup and by the background worker
  */
 void PgAuditLogToFile_calculate_current_filename(void)
 {
+  char *base = NULL;
   char *filename = NULL;
+  uint32 sequence = 0;
+  uint64 file_bytes = 0;
+  uint64 rotation_size = (uint64)guc_pgaudit_ltf_log_rotation_size * 1024;
+  int num_shards = guc_pgaudit_ltf_log_shards;
+  char shard_filename[MAXPGPATH];
+  int shard;
 
   if (UsedShmemSegAddr == NULL || pgaudit_ltf_shm == NULL)
     return;
 
-  filename = PgAuditLogToFile_current_filename();
-  if (filename == NULL)
+  base = PgAuditLogToFile_current_filename(0);
+  if (base == NULL)
   {
     ereport(WARNING, (errmsg("pgauditlogtofile failed to calculate filename")));
     return;
   }
 
+  /* the same time pattern keeps writing to the last file of its sequence */
+  if (strcmp(base, pgaudit_ltf_shm->filename_base) == 0)
+    sequence = pgaudit_ltf_shm->file_sequence;
+
+  /* skip the files already full, this one or left by a previous run */
+  for (;;)
+  {
+    filename = (sequence == 0) ? pstrdup(base) : PgAuditLogToFile_current_filename(sequence);
+    if (filename == NULL)
+    {
+      ereport(WARNING, (errmsg("pgauditlogtofile failed to calculate filename")));
+      pfree(base);
+      return;
+    }
+
+    file_bytes = pgauditlogtofile_file_size(filename, num_shards);
+    if (rotation_size == 0 || file_bytes < rotation_size || sequence == PG_UINT32_MAX)
+      break;
+
+    pfree(filename);
+    sequence++;
+  }
+
+  /* backends open them without creating them */
+  for (shard = 0; shard < num_shards; shard++)
+  {
+    strlcpy(shard_filename, filename, MAXPGPATH);
+    PgAuditLogToFile_shard_filename(shard_filename, shard, num_shards);
+    PgAuditLogToFile_create_file(shard_filename);
+    PgAuditLogToFile_archive_opened(shard_filename);
+  }
+
   LWLockAcquire(&pgaudit_ltf_shm->lock, LW_EXCLUSIVE);
-  memset(pgaudit_ltf_shm->filename, 0, sizeof(pgaudit_ltf_shm->filename));
-  strlcpy(pgaudit_ltf_shm->filename, filename, MAXPGPATH);
+  pgauditlogtofile_write_filename(filename, num_shards);
+  strlcpy(pgaudit_ltf_shm->filename_base, base, MAXPGPATH);
+  pgaudit_ltf_shm->file_sequence = sequence;
+  pg_atomic_write_u64(&pgaudit_ltf_shm->file_bytes, file_bytes);
   LWLockRelease(&pgaudit_ltf_shm->lock);
 
   /* increase generation */
@@ -170,6 +272,66 @@ void PgAuditLogToFile_calculate_current_filename(void)
     pg_atomic_add_fetch_u32(&pgaudit_ltf_shm->rotation_generation, 1);
 
   pfree(filename);
+  pfree(base);
+}
+
+/**
+ * @brief Copies the current audit file name without taking the lock
+ * @param filename: buffer of MAXPGPATH bytes
+ * @return int - number of shards of the file, see PgAuditLogToFile_shard_filename
+ * @note Same protocol as st_changecount in PgBackendStatus, the copy is retried while the worker changes it
+ */
+int PgAuditLogToFile_read_filename(char *filename)
+{
+  int num_shards;
+
+  for (;;)
+  {
+    uint32 before_changecount;
+    uint32 after_changecount;
+
+    before_changecount = pg_atomic_read_u32(&pgaudit_ltf_shm->filename_changecount);
+    pg_read_barrier();
+    memcpy(filename, pgaudit_ltf_shm->filename, MAXPGPATH);
+    num_shards = pgaudit_ltf_shm->num_shards;
+    pg_read_barrier();
+    after_changecount = pg_atomic_read_u32(&pgaudit_ltf_shm->filename_changecount);
+
+    if (before_changecount == after_changecount && (before_changecount & 1) == 0)
+      break;
+
+    /* the worker is in the middle of a rotation, a few instructions */
+    pg_spin_delay();
+  }
+
+  filename[MAXPGPATH - 1] = '\0';
+
+  return num_shards;
+}
+
+/**
+ * @brief Counts the bytes written to the audit file, the first backend crossing log_rotation_size wakes up
+ * the worker
+ * @param bytes: bytes written
+ * @return void
+ */
+void PgAuditLogToFile_add_file_bytes(size_t bytes)
+{
+  uint64 rotation_size;
+  uint64 file_bytes;
+  Latch *worker_latch;
+
+  if (guc_pgaudit_ltf_log_rotation_size < 1 || UsedShmemSegAddr == NULL || pgaudit_ltf_shm == NULL)
+    return;
+
+  rotation_size = (uint64)guc_pgaudit_ltf_log_rotation_size * 1024;
+  file_bytes = pg_atomic_add_fetch_u64(&pgaudit_ltf_shm->file_bytes, bytes);
+  if (file_bytes < rotation_size || file_bytes - bytes >= rotation_size)
+    return;
+
+  worker_latch = pgaudit_ltf_shm->worker_latch;
+  if (worker_latch != NULL)
+    SetLatch(worker_latch);
 }
 
 /**
@@ -184,7 +346,14 @@ bool PgAuditLogToFile_needs_rotate_file(void)
   if (UsedShmemSegAddr == NULL || pgaudit_ltf_shm == NULL)
     return false;
 
-  if (guc_pgaudit_ltf_log_rotation_age < 1)
+  if (guc_pgaudit_ltf_log_rotation_size > 0 &&
+      pg_atomic_read_u64(&pgaudit_ltf_shm->file_bytes) >= (uint64)guc_pgaudit_ltf_log_rotation_size * 1024)
+  {
+    ereport(DEBUG3, (errmsg("pgauditlogtofile needs to rotate file %s by size", pgaudit_ltf_shm->filename)));
+    return true;
+  }
+
+  if (PgAuditLogToFile_rotation_interval() < 1)
     return false;
 
   now = (pg_time_t)time(NULL);
@@ -197,12 +366,52 @@ bool PgAuditLogToFile_needs_rotate_file(void)
   return false;
 }
 
+/**
+ * @brief Obtains the shared slot of a backend
+ * @param proc: PGPROC of the backend
+ * @return PgAuditLogToFileBackend * - the slot or NULL if the process has none (auxiliary processes)
+ */
+PgAuditLogToFileBackend *PgAuditLogToFile_backend_slot(PGPROC *proc)
+{
+  int procno;
+
+  if (UsedShmemSegAddr == NULL || pgaudit_ltf_shm == NULL || proc == NULL)
+    return NULL;
+
+  procno = (int)(proc - ProcGlobal->allProcs);
+  if (procno < 0 || procno >= pgaudit_ltf_shm->num_backends)
+    return NULL;
+
+  return &pgaudit_ltf_shm->backends[procno].slot;
+}
+
+/**
+ * @brief Builds a backend local copy of the main struct, with the prefixes and no backend slots.
+ * Used by the benchmark harness, which runs the hot paths without the shared memory of the extension.
+ * @param void
+ * @return PgAuditLogToFileShm * - struct allocated in CurrentMemoryContext
+ */
+PgAuditLogToFileShm *PgAuditLogToFile_shmem_local(void)
+{
+  PgAuditLogToFileShm *shm;
+  size_t conn_count = sizeof(postgresConnMsg) / sizeof(char *);
+  size_t disconn_count = sizeof(postgresDisconnMsg) / sizeof(char *);
+
+  shm = (PgAuditLogToFileShm *)palloc0(pgauditlogtofile_shm_main_struct_size());
+  pgauditlogtofile_init_prefixes(shm, palloc, postgresConnMsg, conn_count, PGAUDIT_LTF_TYPE_CONNECTION);
+  pgauditlogtofile_init_prefixes(shm, palloc, postgresDisconnMsg, disconn_count, PGAUDIT_LTF_TYPE_DISCONNECTION);
+
+  return shm;
+}
+
 /* private functions */
 /**
- * @brief Helper to initialize a prefix list in shared memory
+ * @brief Helper to initialize a prefix list, in shared memory unless alloc_fn says otherwise
  */
 static void
-pgauditlogtofile_init_prefixes(const char **messages,
+pgauditlogtofile_init_prefixes(PgAuditLogToFileShm *shm,
+                               void *(*alloc_fn)(Size size),
+                               const char **messages,
                                size_t num_messages,
                                PgAuditLogToFilePrefixType type)
 {
@@ -218,12 +427,12 @@ pgauditlogtofile_init_prefixes(const char **messages,
     size_t struct_size = offsetof(PgAuditLogToFilePrefix, prefix) + len + 1;
     PgAuditLogToFilePrefix *p;
 
-    p = (PgAuditLogToFilePrefix *)ShmemAlloc(MAXALIGN(struct_size));
+    p = (PgAuditLogToFilePrefix *)alloc_fn(MAXALIGN(struct_size));
     p->length = (int)len;
     p->type = type;
     memcpy(p->prefix, prefixes[i], len + 1);
 
-    pgaudit_ltf_shm->prefixes[pgaudit_ltf_shm->num_prefixes++] = p;
+    shm->prefixes[shm->num_prefixes++] = p;
     pfree(prefixes[i]);
   }
   pfree(prefixes);
@@ -242,6 +451,10 @@ pgauditlogtofile_shmem_size(void)
 
   size = pgauditlogtofile_shm_main_struct_size();
 
+  /* one slot per backend */
+  size = add_size(size, CACHELINEALIGN(mul_size(pgauditlogtofile_max_backends(), sizeof(PgAuditLogToFileBackendPadded))));
+  size = add_size(size, PgAuditLogToFile_latency_shmem_size(pgauditlogtofile_max_backends()));
+
   /*
    * Reserve worst-case space for all static strings.
    * This avoids double-calling the deduplication logic.
@@ -276,4 +489,63 @@ pgauditlogtofile_shm_main_struct_size(void)
   size = offsetof(PgAuditLogToFileShm, prefixes);
   size = add_size(size, mul_size(add_size(conn_count, disconn_count), sizeof(PgAuditLogToFilePrefix *)));
   return MAXALIGN(size);
-}
\ No newline at end of file
+}
+
+/**
+ * @brief Number of backend slots, regular backends and background workers are the first procs in ProcGlobal
+ */
+static int
+pgauditlogtofile_max_backends(void)
+{
+#if (PG_VERSION_NUM >= 150000)
+  return MaxBackends;
+#else
+  /* MaxBackends is still not calculated when _PG_init requests the space */
+  return MaxConnections + autovacuum_max_workers + 1 + max_worker_processes + max_wal_senders;
+#endif
+}
+
+/**
+ * @brief Publishes the current audit file name for PgAuditLogToFile_read_filename
+ * @param filename: new audit file
+ * @param num_shards: number of shards of the file
+ * @return void
+ * @note Single writer, the caller holds the lock
+ */
+static void
+pgauditlogtofile_write_filename(const char *filename, int num_shards)
+{
+  /* odd while the name changes */
+  pg_atomic_fetch_add_u32(&pgaudit_ltf_shm->filename_changecount, 1);
+  pg_write_barrier();
+  memset(pgaudit_ltf_shm->filename, 0, sizeof(pgaudit_ltf_shm->filename));
+  strlcpy(pgaudit_ltf_shm->filename, filename, MAXPGPATH);
+  pgaudit_ltf_shm->num_shards = num_shards;
+  pg_write_barrier();
+  pg_atomic_fetch_add_u32(&pgaudit_ltf_shm->filename_changecount, 1);
+}
+
+/**
+ * @brief Size of an audit file on disk, adding up all its shards
+ * @param filename: audit file
+ * @param num_shards: number of shards
+ * @return uint64 - bytes, 0 if it doesn't exist
+ */
+static uint64
+pgauditlogtofile_file_size(const char *filename, int num_shards)
+{
+  char shard_filename[MAXPGPATH];
+  struct stat st;
+  uint64 size = 0;
+  int shard;
+
+  for (shard = 0; shard < num_shards; shard++)
+  {
+    strlcpy(shard_filename, filename, MAXPGPATH);
+    PgAuditLogToFile_shard_filename(shard_filename, shard, num_shards);
+    if (stat(shard_filename, &st) == 0)
+      size += (uint64)st.st_size;
+  }
+
+  return size;
+}
@@ -13,6 +13,9 @@
 #define _LOGTOFILE_SHMEM_H_
 
 #include <postgres.h>
+#include <storage/proc.h>
+
+#include "logtofile_vars.h"
 
 /* Hook functions */
 extern void PgAuditLogToFile_shmem_startup(void);
@@ -20,6 +23,10 @@ extern void PgAuditLogToFile_shmem_shutdown(int code, Datum arg);
 extern void PgAuditLogToFile_shmem_request(void);
 
 extern void PgAuditLogToFile_calculate_current_filename(void);
+extern int PgAuditLogToFile_read_filename(char *filename);
 extern bool PgAuditLogToFile_needs_rotate_file(void);
+extern void PgAuditLogToFile_add_file_bytes(size_t bytes);
+extern PgAuditLogToFileBackend *PgAuditLogToFile_backend_slot(PGPROC *proc);
+extern PgAuditLogToFileShm *PgAuditLogToFile_shmem_local(void);
 
 #endif
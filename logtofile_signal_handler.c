@@ -11,17 +11,42 @@
  */
 #include "logtofile_signal_handler.h"
 
-#include "logtofile_urgentclose.h"
+#include "logtofile_close_barrier.h"
 #include "logtofile_vars.h"
 
+#include <port.h>
 #include <storage/procsignal.h>
 
 #include <errno.h>
 #include <signal.h>
 #include <unistd.h>
 
+/* variables to use only in this unit */
+static bool pgaudit_ltf_sigusr1_setup = false;
+
 /* public methods */
 
+/**
+ * @brief Installs the SIGUSR1 handler in the backend, only once
+ * @param void
+ * @return void
+ */
+void PgAuditLogToFile_SIGUSR1_setup(void)
+{
+  if (pgaudit_ltf_sigusr1_setup)
+    return;
+
+#if (PG_VERSION_NUM >= 180000)
+  /* setup a signal handler for SIGUSR1 in the backend, and hope we don't lose another */
+  /* we will always call the default postgresql signal handler */
+  pqsignal(SIGUSR1, PgAuditLogToFile_SIGUSR1);
+#else
+  /* setup a signal handler for SIGUSR1 in the backend, and save the existing */
+  pgaudit_ltf_prev_sigusr1_handler = pqsignal(SIGUSR1, PgAuditLogToFile_SIGUSR1);
+#endif
+  pgaudit_ltf_sigusr1_setup = true;
+}
+
 /**
  * @brief Signal handler for SIGUSR1 in backends
  * @param signal_arg: signal number
@@ -31,7 +56,8 @@ void PgAuditLogToFile_SIGUSR1(SIGNAL_ARGS)
 {
   int save_errno = errno;
 
-  PgAuditLogToFile_close_file_urgent();
+  /* only take note, the audit file is closed at the next safe point; the standard handler sets the latch */
+  PgAuditLogToFile_close_barrier_signaled();
 
   /* Trigger any additional signal handler, minus ignore and default */
   if (pgaudit_ltf_prev_sigusr1_handler &&
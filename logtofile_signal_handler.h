@@ -15,5 +15,6 @@
 #include <postgres.h>
 
 extern void PgAuditLogToFile_SIGUSR1(SIGNAL_ARGS);
+extern void PgAuditLogToFile_SIGUSR1_setup(void);
 
 #endif /* _LOGTOFILE_SIGNAL_HANDLER_H_ */
\ No newline at end of file
@@ -0,0 +1,262 @@
+/*-------------------------------------------------------------------------
+ *
+ * logtofile_stats.c
+ *      Statistics of the audit writes
+ *
+ * Copyright (c) 2026, Francisco Miguel Biete Banon
+ *
+ * This code is released under the PostgreSQL licence, as given at
+ *  http://www.postgresql.org/about/licence/
+ *-------------------------------------------------------------------------
+ */
+#include "logtofile_stats.h"
+
+#include "logtofile_shmem.h"
+#include "logtofile_vars.h"
+
+#include <access/htup_details.h>
+#include <funcapi.h>
+#include <miscadmin.h>
+#include <storage/ipc.h>
+#include <storage/pg_shmem.h>
+#include <storage/proc.h>
+#include <utils/tuplestore.h>
+
+/* Defines */
+#define PGAUDIT_LTF_STAT_COLS 7
+
+/* variables to use only in this unit */
+static PgAuditLogToFileBackend *pgaudit_ltf_stats_slot = NULL;
+static bool pgaudit_ltf_stats_released = false;
+
+/* forward declaration private functions */
+static PgAuditLogToFileStats *pgauditlogtofile_stats_local(void);
+static void pgauditlogtofile_stats_release(int code, Datum arg);
+static void pgauditlogtofile_stats_add_global(const PgAuditLogToFileStats *stats);
+static void pgauditlogtofile_stats_tuple(Tuplestorestate *tupstore, TupleDesc tupdesc, int pid,
+                                         const PgAuditLogToFileStats *stats);
+
+PG_FUNCTION_INFO_V1(pgauditlogtofile_stat);
+
+/**
+ * @brief Counts an audit record write
+ * @param success: true if the record reached the file
+ * @param bytes_formatted: size of the formatted record
+ * @param bytes_written: size written to the file, after compression
+ * @return void
+ */
+void PgAuditLogToFile_stats_write(bool success, size_t bytes_formatted, size_t bytes_written)
+{
+  PgAuditLogToFileStats *stats = pgauditlogtofile_stats_local();
+
+  if (stats == NULL)
+  {
+    /* exiting backend (disconnection record) or postmaster, go straight to the shared totals */
+    if (UsedShmemSegAddr == NULL || pgaudit_ltf_shm == NULL)
+      return;
+
+    if (success)
+    {
+      pg_atomic_fetch_add_u64(&pgaudit_ltf_shm->stats_records, 1);
+      pg_atomic_fetch_add_u64(&pgaudit_ltf_shm->stats_bytes_formatted, bytes_formatted);
+      pg_atomic_fetch_add_u64(&pgaudit_ltf_shm->stats_bytes_written, bytes_written);
+    }
+    else
+      pg_atomic_fetch_add_u64(&pgaudit_ltf_shm->stats_write_failures, 1);
+    return;
+  }
+
+  if (success)
+  {
+    stats->records++;
+    stats->bytes_formatted += bytes_formatted;
+    stats->bytes_written += bytes_written;
+  }
+  else
+    stats->write_failures++;
+}
+
+/**
+ * @brief Counts an open of the audit log file
+ * @param void
+ * @return void
+ */
+void PgAuditLogToFile_stats_reopen(void)
+{
+  PgAuditLogToFileStats *stats = pgauditlogtofile_stats_local();
+
+  if (stats != NULL)
+    stats->reopens++;
+  else if (UsedShmemSegAddr != NULL && pgaudit_ltf_shm != NULL)
+    pg_atomic_fetch_add_u64(&pgaudit_ltf_shm->stats_reopens, 1);
+}
+
+/**
+ * @brief SQL function - statistics of every backend plus a total row with NULL pid
+ * @return Datum - set of records
+ */
+Datum pgauditlogtofile_stat(PG_FUNCTION_ARGS)
+{
+  ReturnSetInfo *rsinfo = (ReturnSetInfo *)fcinfo->resultinfo;
+  TupleDesc tupdesc;
+  Tuplestorestate *tupstore;
+  MemoryContext oldcontext;
+  PgAuditLogToFileStats total;
+  int i;
+
+  if (rsinfo == NULL || !IsA(rsinfo, ReturnSetInfo))
+    ereport(ERROR,
+            (errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+             errmsg("set-valued function called in context that cannot accept a set")));
+  if (!(rsinfo->allowedModes & SFRM_Materialize))
+    ereport(ERROR,
+            (errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+             errmsg("materialize mode required, but it is not allowed in this context")));
+  if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+    elog(ERROR, "return type must be a row type");
+
+  if (UsedShmemSegAddr == NULL || pgaudit_ltf_shm == NULL)
+    ereport(ERROR,
+            (errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+             errmsg("pgauditlogtofile must be loaded via shared_preload_libraries")));
+
+  oldcontext = MemoryContextSwitchTo(rsinfo->econtext->ecxt_per_query_memory);
+  tupstore = tuplestore_begin_heap(true, false, work_mem);
+  rsinfo->returnMode = SFRM_Materialize;
+  rsinfo->setResult = tupstore;
+  rsinfo->setDesc = tupdesc;
+  MemoryContextSwitchTo(oldcontext);
+
+  total.records = pg_atomic_read_u64(&pgaudit_ltf_shm->stats_records);
+  total.bytes_formatted = pg_atomic_read_u64(&pgaudit_ltf_shm->stats_bytes_formatted);
+  total.bytes_written = pg_atomic_read_u64(&pgaudit_ltf_shm->stats_bytes_written);
+  total.write_failures = pg_atomic_read_u64(&pgaudit_ltf_shm->stats_write_failures);
+  total.reopens = pg_atomic_read_u64(&pgaudit_ltf_shm->stats_reopens);
+
+  for (i = 0; i < pgaudit_ltf_shm->num_backends; i++)
+  {
+    PgAuditLogToFileBackend *backend = &pgaudit_ltf_shm->backends[i].slot;
+    PgAuditLogToFileStats stats;
+    int pid = backend->stats_pid;
+
+    if (pid == 0)
+      continue;
+
+    /* the owner keeps writing, the values may be a few records behind */
+    pg_read_barrier();
+    memcpy(&stats, &backend->stats, sizeof(PgAuditLogToFileStats));
+
+    pgauditlogtofile_stats_tuple(tupstore, tupdesc, pid, &stats);
+
+    total.records += stats.records;
+    total.bytes_formatted += stats.bytes_formatted;
+    total.bytes_written += stats.bytes_written;
+    total.write_failures += stats.write_failures;
+    total.reopens += stats.reopens;
+  }
+
+  pgauditlogtofile_stats_tuple(tupstore, tupdesc, 0, &total);
+
+  return (Datum)0;
+}
+
+/* private functions */
+
+/**
+ * @brief Claims the shared slot of the backend the first time it is needed
+ * @return PgAuditLogToFileStats * - statistics of the backend or NULL if it has no slot
+ */
+static PgAuditLogToFileStats *
+pgauditlogtofile_stats_local(void)
+{
+  if (pgaudit_ltf_stats_slot != NULL)
+    return &pgaudit_ltf_stats_slot->stats;
+
+  if (pgaudit_ltf_stats_released || MyProc == NULL)
+    return NULL;
+
+  pgaudit_ltf_stats_slot = PgAuditLogToFile_backend_slot(MyProc);
+  if (pgaudit_ltf_stats_slot == NULL)
+    return NULL;
+
+  memset(&pgaudit_ltf_stats_slot->stats, 0, sizeof(PgAuditLogToFileStats));
+  pg_write_barrier();
+  pgaudit_ltf_stats_slot->stats_pid = MyProcPid;
+
+  /* runs before ProcKill hands our PGPROC, and the slot, to another backend */
+  before_shmem_exit(pgauditlogtofile_stats_release, (Datum)0);
+
+  return &pgaudit_ltf_stats_slot->stats;
+}
+
+/**
+ * @brief Exit callback - moves the statistics of the backend to the shared totals and frees the slot
+ * @param code: unused
+ * @param arg: unused
+ * @return void
+ */
+static void
+pgauditlogtofile_stats_release(int code, Datum arg)
+{
+  if (pgaudit_ltf_stats_slot == NULL)
+    return;
+
+  pgaudit_ltf_stats_slot->stats_pid = 0;
+  pg_write_barrier();
+  pgauditlogtofile_stats_add_global(&pgaudit_ltf_stats_slot->stats);
+
+  pgaudit_ltf_stats_slot = NULL;
+  pgaudit_ltf_stats_released = true;
+}
+
+/**
+ * @brief Adds statistics to the shared totals
+ * @param stats: statistics to add
+ * @return void
+ */
+static void
+pgauditlogtofile_stats_add_global(const PgAuditLogToFileStats *stats)
+{
+  pg_atomic_fetch_add_u64(&pgaudit_ltf_shm->stats_records, stats->records);
+  pg_atomic_fetch_add_u64(&pgaudit_ltf_shm->stats_bytes_formatted, stats->bytes_formatted);
+  pg_atomic_fetch_add_u64(&pgaudit_ltf_shm->stats_bytes_written, stats->bytes_written);
+  pg_atomic_fetch_add_u64(&pgaudit_ltf_shm->stats_write_failures, stats->write_failures);
+  pg_atomic_fetch_add_u64(&pgaudit_ltf_shm->stats_reopens, stats->reopens);
+}
+
+/**
+ * @brief Adds a row to the result of pgauditlogtofile_stat
+ * @param tupstore: result
+ * @param tupdesc: row type
+ * @param pid: backend pid, 0 for the total row
+ * @param stats: statistics
+ * @return void
+ */
+static void
+pgauditlogtofile_stats_tuple(Tuplestorestate *tupstore, TupleDesc tupdesc, int pid,
+                             const PgAuditLogToFileStats *stats)
+{
+  Datum values[PGAUDIT_LTF_STAT_COLS];
+  bool nulls[PGAUDIT_LTF_STAT_COLS];
+  int i = 0;
+
+  memset(nulls, 0, sizeof(nulls));
+
+  if (pid != 0)
+    values[i++] = Int32GetDatum(pid);
+  else
+    nulls[i++] = true;
+  values[i++] = Int64GetDatum((int64)stats->records);
+  values[i++] = Int64GetDatum((int64)stats->bytes_formatted);
+  values[i++] = Int64GetDatum((int64)stats->bytes_written);
+  if (stats->bytes_written > 0)
+    values[i++] = Float8GetDatum((double)stats->bytes_formatted / (double)stats->bytes_written);
+  else
+    nulls[i++] = true;
+  values[i++] = Int64GetDatum((int64)stats->write_failures);
+  values[i++] = Int64GetDatum((int64)stats->reopens);
+
+  Assert(i == PGAUDIT_LTF_STAT_COLS);
+
+  tuplestore_putvalues(tupstore, tupdesc, values, nulls);
+}
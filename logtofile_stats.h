@@ -0,0 +1,24 @@
+/*-------------------------------------------------------------------------
+ *
+ * logtofile_stats.h
+ *      Statistics of the audit writes
+ *
+ * Copyright (c) 2026, Francisco Miguel Biete Banon
+ *
+ * This code is released under the PostgreSQL licence, as given at
+ *  http://www.postgresql.org/about/licence/
+ *-------------------------------------------------------------------------
+ */
+#ifndef _LOGTOFILE_STATS_H_
+#define _LOGTOFILE_STATS_H_
+
+#include <postgres.h>
+#include <fmgr.h>
+
+extern void PgAuditLogToFile_stats_write(bool success, size_t bytes_formatted, size_t bytes_written);
+extern void PgAuditLogToFile_stats_reopen(void);
+
+/* SQL functions */
+extern Datum pgauditlogtofile_stat(PG_FUNCTION_ARGS);
+
+#endif
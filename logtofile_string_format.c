@@ -11,7 +11,6 @@
  */
 #include "logtofile_string_format.h"
 
-#include "logtofile_autoclose.h"
 #include "logtofile_guc.h"
 #include "logtofile_shmem.h"
 #include "logtofile_vars.h"
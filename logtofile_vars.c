@@ -16,35 +16,39 @@ char *guc_pgaudit_ltf_log_directory = NULL;
 char *guc_pgaudit_ltf_log_filename = NULL;
 int guc_pgaudit_ltf_log_file_mode = 0600;
 int guc_pgaudit_ltf_log_rotation_age = HOURS_PER_DAY * MINS_PER_HOUR; // Default: 1 day
+int guc_pgaudit_ltf_log_rotation_age_seconds = 0;                     // Default: off
+int guc_pgaudit_ltf_log_rotation_nudge_delay = -1;                    // Default: off
+int guc_pgaudit_ltf_log_rotation_size = 0;                            // Default: off
+int guc_pgaudit_ltf_log_shards = 1;                                   // Default: 1 (no shards)
+int guc_pgaudit_ltf_log_retention_age = 0;                            // Default: off
+int guc_pgaudit_ltf_log_retention_size = 0;                           // Default: off
+char *guc_pgaudit_ltf_log_archive_command = NULL;
+int guc_pgaudit_ltf_log_archive_max_parallel = 1;                     // Default: 1
 bool guc_pgaudit_ltf_log_connections = false;                         // Default: off
 bool guc_pgaudit_ltf_log_disconnections = false;                      // Default: off
 int guc_pgaudit_ltf_auto_close_minutes = 0;                           // Default: off
 int guc_pgaudit_ltf_log_format = PGAUDIT_LTF_FORMAT_CSV;              // Default: csv
 bool guc_pgaudit_ltf_log_execution_time = false;                      // Default: off
 bool guc_pgaudit_ltf_log_execution_memory = false;                    // Default: off
+int guc_pgaudit_ltf_log_execution_memory_sample_interval = 1000;      // Default: every 1000 node executions
+bool guc_pgaudit_ltf_log_execution_buffers = false;                   // Default: off
+bool guc_pgaudit_ltf_log_execution_jit = false;                       // Default: off
+bool guc_pgaudit_ltf_log_execution_rusage = false;                    // Default: off
+bool guc_pgaudit_ltf_log_execution_parallel = false;                  // Default: off
+int guc_pgaudit_ltf_log_execution_plan_min_duration = -1;             // Default: off
+bool guc_pgaudit_ltf_log_execution_plan_analyze = false;               // Default: off
+bool guc_pgaudit_ltf_log_latency_histograms = false;                  // Default: off
 int guc_pgaudit_ltf_log_compression = PGAUDIT_LTF_COMPRESSION_OFF;    // Default: off
 int guc_pgaudit_ltf_log_compression_level = 0;                        // Default: 0 (Library default)
 
 // Audit log file handler
 int pgaudit_ltf_file_handler = -1;
 
-// Background auto-close file handler
-pg_atomic_flag pgaudit_ltf_autoclose_flag_thread;
-pthread_t pgaudit_ltf_autoclose_thread;
-pthread_attr_t pgaudit_ltf_autoclose_thread_attr;
-pg_time_t pgaudit_ltf_autoclose_active_ts;
-
-// Statement time measurement
-instr_time pgaudit_ltf_statement_start_time;
-instr_time pgaudit_ltf_statement_end_time;
-
-// Statement memory measurement
-Size pgaudit_ltf_statement_memory_start = 0;
-Size pgaudit_ltf_statement_memory_end = 0;
-Size pgaudit_ltf_statement_memory_peak = 0;
-
 // Pending audit data
-PendingAudit pgaudit_ltf_pending_audit = {0};
+PendingAudit *pgaudit_ltf_pending_stack = NULL;
+int pgaudit_ltf_pending_depth = 0;
+int pgaudit_ltf_pending_max_depth = 0;
+MemoryContext pgaudit_ltf_pending_context = NULL;
 
 // Hook log
 emit_log_hook_type pgaudit_ltf_prev_emit_log_hook = NULL;
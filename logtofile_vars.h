@@ -15,18 +15,19 @@
 #include <postgres.h>
 #include <datatype/timestamp.h>
 #include <executor/executor.h>
+#include <executor/instrument.h>
+#include <jit/jit.h>
 #include <miscadmin.h>
 #include <pgtime.h>
 #include <port/atomics.h>
 #include <portability/instr_time.h>
 #include <signal.h>
+#include <sys/resource.h>
 #include <storage/ipc.h>
 #include <storage/lwlock.h>
 #include <utils/timestamp.h>
 #include <utils/elog.h>
 
-#include <pthread.h>
-
 typedef enum
 {
   PGAUDIT_LTF_FORMAT_CSV,
@@ -41,46 +42,97 @@ typedef enum
   PGAUDIT_LTF_COMPRESSION_ZSTD
 } PgAuditLogToFileCompression;
 
+// Maximum of pgaudit.log_shards
+#define PGAUDIT_LTF_MAX_SHARDS 64
+// Maximum of pgaudit.log_archive_max_parallel
+#define PGAUDIT_LTF_MAX_ARCHIVE_PARALLEL 16
+
 // Guc
 extern char *guc_pgaudit_ltf_log_directory;
 extern char *guc_pgaudit_ltf_log_filename;
 extern int guc_pgaudit_ltf_log_file_mode;
 extern int guc_pgaudit_ltf_log_rotation_age;
+extern int guc_pgaudit_ltf_log_rotation_age_seconds;
+extern int guc_pgaudit_ltf_log_rotation_nudge_delay;
+extern int guc_pgaudit_ltf_log_rotation_size;
+extern int guc_pgaudit_ltf_log_shards;
+extern int guc_pgaudit_ltf_log_retention_age;
+extern int guc_pgaudit_ltf_log_retention_size;
+extern char *guc_pgaudit_ltf_log_archive_command;
+extern int guc_pgaudit_ltf_log_archive_max_parallel;
 extern bool guc_pgaudit_ltf_log_connections;
 extern bool guc_pgaudit_ltf_log_disconnections;
 extern int guc_pgaudit_ltf_auto_close_minutes;
 extern int guc_pgaudit_ltf_log_format;
 extern bool guc_pgaudit_ltf_log_execution_time;
 extern bool guc_pgaudit_ltf_log_execution_memory;
+extern int guc_pgaudit_ltf_log_execution_memory_sample_interval;
+extern bool guc_pgaudit_ltf_log_execution_buffers;
+extern bool guc_pgaudit_ltf_log_execution_jit;
+extern bool guc_pgaudit_ltf_log_execution_rusage;
+extern bool guc_pgaudit_ltf_log_execution_parallel;
+extern int guc_pgaudit_ltf_log_execution_plan_min_duration;
+extern bool guc_pgaudit_ltf_log_execution_plan_analyze;
+extern bool guc_pgaudit_ltf_log_latency_histograms;
 extern int guc_pgaudit_ltf_log_compression;
 extern int guc_pgaudit_ltf_log_compression_level;
 
 // Audit log file handler
 extern int pgaudit_ltf_file_handler;
 
-// Background auto-close file handler
-extern pg_atomic_flag pgaudit_ltf_autoclose_flag_thread;
-extern pthread_t pgaudit_ltf_autoclose_thread;
-extern pthread_attr_t pgaudit_ltf_autoclose_thread_attr;
-extern pg_time_t pgaudit_ltf_autoclose_active_ts;
-
-// Statement time measurement
-extern instr_time pgaudit_ltf_statement_start_time;
-extern instr_time pgaudit_ltf_statement_end_time;
-
-// Statement memory measurement
-extern Size pgaudit_ltf_statement_memory_start;
-extern Size pgaudit_ltf_statement_memory_end;
-extern Size pgaudit_ltf_statement_memory_peak;
-
-// Pending audit data to capture stats at the end of execution
+// Pending audit data to capture stats at the end of execution, one entry per executor level
 typedef struct
 {
-  ErrorData *edata;
-  bool active;
+  QueryDesc *query_desc;
+  SubTransactionId subxid;
+  bool running;
+  // Statement time measurement
+  instr_time start_time;
+  instr_time end_time;
+  // Statement memory measurement
+  Size memory_start;
+  Size memory_end;
+  Size memory_peak;
+  // Statement buffer and WAL usage
+  bool buffers_measured;
+  BufferUsage buffers_start;
+  BufferUsage buffers;
+  WalUsage wal_start;
+  WalUsage wal;
+  // Statement JIT usage
+  bool jit_measured;
+  JitInstrumentation jit;
+  // Statement OS resource usage
+  bool rusage_measured;
+  struct rusage rusage_start;
+  double rusage_user_time;
+  double rusage_system_time;
+  long rusage_nvcsw;
+  long rusage_nivcsw;
+  bool io_start_valid;
+  bool io_measured;
+  uint64 io_read_bytes_start;
+  uint64 io_write_bytes_start;
+  uint64 io_read_bytes;
+  uint64 io_write_bytes;
+  // Statement parallel workers usage
+  bool parallel_measured;
+  uint64 parallel_workers_start;
+  uint64 parallel_memory_start;
+  uint64 parallel_cpu_usec_start;
+  uint64 parallel_workers;
+  Size parallel_memory_peak;
+  double parallel_cpu_time;
+  // Statement plan, EXPLAIN (FORMAT JSON) of slow statements
+  char *plan;
+  // ErrorData records in emission order
+  List *records;
 } PendingAudit;
 
-extern PendingAudit pgaudit_ltf_pending_audit;
+extern PendingAudit *pgaudit_ltf_pending_stack;
+extern int pgaudit_ltf_pending_depth;
+extern int pgaudit_ltf_pending_max_depth;
+extern MemoryContext pgaudit_ltf_pending_context;
 
 // Hook log
 extern emit_log_hook_type pgaudit_ltf_prev_emit_log_hook;
@@ -107,13 +159,121 @@ typedef struct PgAuditLogToFilePrefix
   char prefix[FLEXIBLE_ARRAY_MEMBER];
 } PgAuditLogToFilePrefix;
 
+// Audit write statistics
+typedef struct PgAuditLogToFileStats
+{
+  uint64 records;
+  uint64 bytes_formatted;
+  uint64 bytes_written;
+  uint64 write_failures;
+  uint64 reopens;
+} PgAuditLogToFileStats;
+
+// Archive command statistics, written by the worker under the lock
+typedef struct PgAuditLogToFileArchiveStats
+{
+  uint64 archived_count;
+  char last_archived_file[MAXPGPATH];
+  TimestampTz last_archived_time;
+  uint64 failed_count;
+  char last_failed_file[MAXPGPATH];
+  TimestampTz last_failed_time;
+  int pending;
+  int running;
+} PgAuditLogToFileArchiveStats;
+
+// Stages of the audit write pipeline with latency histograms
+typedef enum
+{
+  PGAUDIT_LTF_STAGE_CAPTURE,
+  PGAUDIT_LTF_STAGE_FORMAT,
+  PGAUDIT_LTF_STAGE_COMPRESS,
+  PGAUDIT_LTF_STAGE_WRITE,
+  PGAUDIT_LTF_STAGE_COUNT
+} PgAuditLogToFileStage;
+
+// Log-linear buckets in nanoseconds: 2^3 sub-buckets per power of two, up to 2^36 ns (~68 s)
+#define PGAUDIT_LTF_LATENCY_SUB_BITS 3
+#define PGAUDIT_LTF_LATENCY_MAX_EXP 36
+#define PGAUDIT_LTF_LATENCY_BUCKETS ((PGAUDIT_LTF_LATENCY_MAX_EXP - PGAUDIT_LTF_LATENCY_SUB_BITS + 1) << PGAUDIT_LTF_LATENCY_SUB_BITS)
+
+// Latency histograms of a backend, written without locks by the owner only
+typedef struct PgAuditLogToFileLatency
+{
+  uint32 reset_generation;
+  uint64 buckets[PGAUDIT_LTF_STAGE_COUNT][PGAUDIT_LTF_LATENCY_BUCKETS];
+} PgAuditLogToFileLatency;
+
+// Per-backend slot, indexed by the position of the PGPROC in ProcGlobal->allProcs
+typedef struct PgAuditLogToFileBackend
+{
+  // Usage of the parallel workers of this backend, accumulated by the workers
+  pg_atomic_uint64 parallel_workers;
+  pg_atomic_uint64 parallel_memory;
+  pg_atomic_uint64 parallel_cpu_usec;
+  // Statistics of the backend using the slot, written without locks by the owner only
+  int stats_pid;
+  PgAuditLogToFileStats stats;
+  // The backend holds the audit file open, the rotation generation of the file, and the last close barrier
+  // it acknowledged. The generation can be older than the file, never newer.
+  pg_atomic_uint32 fd_open;
+  pg_atomic_uint32 open_generation;
+  pg_atomic_uint64 close_ack;
+  // Last audit record written (pg_time_t), and the idle close requested by the worker (pgaudit.log_autoclose_minutes)
+  pg_atomic_uint64 last_write;
+  pg_atomic_uint32 idle_close;
+} PgAuditLogToFileBackend;
+
+// Slots are padded to whole cache lines, each backend writes its own on every record
+typedef union PgAuditLogToFileBackendPadded
+{
+  PgAuditLogToFileBackend slot;
+  char pad[TYPEALIGN(PG_CACHE_LINE_SIZE, sizeof(PgAuditLogToFileBackend))];
+} PgAuditLogToFileBackendPadded;
+
+/*
+ * The fields are grouped by access pattern, with padding between the groups
+ * so the ones written on every record don't invalidate the cache lines read on
+ * every record.
+ */
 typedef struct pgAuditLogToFileShm
 {
-  LWLock lock;
-  char filename[MAXPGPATH];
-  pg_time_t next_rotation_time;
+  // Read on every record, only written by rotations and by the worker
   pg_atomic_uint32 rotation_generation;
+  // Close barrier: generation requested by the worker, and its latch for the acknowledgements
+  pg_atomic_uint64 close_generation;
+  struct Latch *worker_latch;
+  pg_atomic_uint32 latency_reset_generation;
+  int num_backends;
+  PgAuditLogToFileBackendPadded *backends;
+  // Latency histograms, one per backend plus the backends that already exited, NULL if disabled
+  PgAuditLogToFileLatency *latency;
   size_t num_prefixes;
+  char pad_read_mostly[PG_CACHE_LINE_SIZE];
+  // Written on every record: the last sequence number, and the bytes written to the current file (size rotation)
+  pg_atomic_uint64 record_sequence;
+  pg_atomic_uint64 file_bytes;
+  char pad_written[PG_CACHE_LINE_SIZE];
+  // Current file and number of shards, written by the worker and read by the backends without locks, see
+  // PgAuditLogToFile_read_filename
+  pg_atomic_uint32 filename_changecount;
+  char filename[MAXPGPATH];
+  int num_shards;
+  // Worker state, changes are serialized by the lock
+  LWLock lock;
+  pg_time_t next_rotation_time;
+  // Size rotation: the log_filename expansion the current file is a sequence of
+  char filename_base[MAXPGPATH];
+  uint32 file_sequence;
+  // Audit record sequence saved in the state file, only the postmaster at startup and the worker change it
+  uint64 sequence_reserved;
+  // Statistics of the backends that already exited
+  pg_atomic_uint64 stats_records;
+  pg_atomic_uint64 stats_bytes_formatted;
+  pg_atomic_uint64 stats_bytes_written;
+  pg_atomic_uint64 stats_write_failures;
+  pg_atomic_uint64 stats_reopens;
+  PgAuditLogToFileArchiveStats archive_stats;
   PgAuditLogToFilePrefix *prefixes[FLEXIBLE_ARRAY_MEMBER];
 } PgAuditLogToFileShm;
 
@@ -0,0 +1,96 @@
+/*-------------------------------------------------------------------------
+ *
+ * logtofile_wait_event.c
+ *      Wait events reported by backends around the audit file I/O
+ *
+ * Copyright (c) 2026, Francisco Miguel Biete Banon
+ *
+ * This code is released under the PostgreSQL licence, as given at
+ *  http://www.postgresql.org/about/licence/
+ *-------------------------------------------------------------------------
+ */
+#include "logtofile_wait_event.h"
+
+#include <utils/backend_status.h>
+#include <utils/wait_event.h>
+
+/*
+ * Wait events for pg_stat_activity visibility. Registering them takes a lock,
+ * so it is not done from emit_log but from the first ExecutorStart of the
+ * backend; until then the generic Extension wait event is reported.
+ */
+static uint32 pgaudit_ltf_wait_events[PGAUDIT_LTF_WAIT_COUNT] = {
+    PG_WAIT_EXTENSION,
+    PG_WAIT_EXTENSION,
+    PG_WAIT_EXTENSION,
+    PG_WAIT_EXTENSION};
+static bool pgaudit_ltf_wait_events_registered = false;
+
+/* open, compress and write report their own event while the statement records are flushed */
+static bool pgaudit_ltf_wait_flushing = false;
+static PgAuditLogToFileWaitEvent pgaudit_ltf_wait_current = PGAUDIT_LTF_WAIT_COUNT;
+
+/**
+ * @brief Registers the custom wait events in this backend
+ * @param void
+ * @return void
+ */
+void PgAuditLogToFile_wait_events_init(void)
+{
+  if (pgaudit_ltf_wait_events_registered)
+    return;
+
+#if (PG_VERSION_NUM >= 170000)
+  pgaudit_ltf_wait_events[PGAUDIT_LTF_WAIT_OPEN] = WaitEventExtensionNew("AuditOpen");
+  pgaudit_ltf_wait_events[PGAUDIT_LTF_WAIT_WRITE] = WaitEventExtensionNew("AuditWrite");
+  pgaudit_ltf_wait_events[PGAUDIT_LTF_WAIT_COMPRESS] = WaitEventExtensionNew("AuditCompress");
+  pgaudit_ltf_wait_events[PGAUDIT_LTF_WAIT_FLUSH] = WaitEventExtensionNew("AuditFlushWait");
+#endif
+  /* custom wait events for extensions were still not available before 17 */
+  pgaudit_ltf_wait_events_registered = true;
+}
+
+/**
+ * @brief Reports the start of a wait in pg_stat_activity
+ * @param event: wait event
+ * @return void
+ */
+void PgAuditLogToFile_wait_start(PgAuditLogToFileWaitEvent event)
+{
+  if (event == PGAUDIT_LTF_WAIT_FLUSH)
+    pgaudit_ltf_wait_flushing = true;
+
+  pgaudit_ltf_wait_current = event;
+  pgstat_report_wait_start(pgaudit_ltf_wait_events[event]);
+}
+
+/**
+ * @brief Reports the end of a wait, going back to AuditFlushWait inside a flush
+ * @param void
+ * @return void
+ */
+void PgAuditLogToFile_wait_end(void)
+{
+  /* an inner wait finished, the flush goes on */
+  if (pgaudit_ltf_wait_flushing && pgaudit_ltf_wait_current != PGAUDIT_LTF_WAIT_FLUSH)
+  {
+    pgaudit_ltf_wait_current = PGAUDIT_LTF_WAIT_FLUSH;
+    pgstat_report_wait_start(pgaudit_ltf_wait_events[PGAUDIT_LTF_WAIT_FLUSH]);
+    return;
+  }
+
+  pgaudit_ltf_wait_flushing = false;
+  pgaudit_ltf_wait_current = PGAUDIT_LTF_WAIT_COUNT;
+  pgstat_report_wait_end();
+}
+
+/**
+ * @brief Forgets a flush interrupted by an error, the abort already cleared the wait event
+ * @param void
+ * @return void
+ */
+void PgAuditLogToFile_wait_reset(void)
+{
+  pgaudit_ltf_wait_flushing = false;
+  pgaudit_ltf_wait_current = PGAUDIT_LTF_WAIT_COUNT;
+}
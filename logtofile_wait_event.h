@@ -0,0 +1,31 @@
+/*-------------------------------------------------------------------------
+ *
+ * logtofile_wait_event.h
+ *      Wait events reported by backends around the audit file I/O
+ *
+ * Copyright (c) 2026, Francisco Miguel Biete Banon
+ *
+ * This code is released under the PostgreSQL licence, as given at
+ *  http://www.postgresql.org/about/licence/
+ *-------------------------------------------------------------------------
+ */
+#ifndef _LOGTOFILE_WAIT_EVENT_H_
+#define _LOGTOFILE_WAIT_EVENT_H_
+
+#include <postgres.h>
+
+typedef enum
+{
+  PGAUDIT_LTF_WAIT_OPEN,
+  PGAUDIT_LTF_WAIT_WRITE,
+  PGAUDIT_LTF_WAIT_COMPRESS,
+  PGAUDIT_LTF_WAIT_FLUSH,
+  PGAUDIT_LTF_WAIT_COUNT
+} PgAuditLogToFileWaitEvent;
+
+extern void PgAuditLogToFile_wait_events_init(void);
+extern void PgAuditLogToFile_wait_start(PgAuditLogToFileWaitEvent event);
+extern void PgAuditLogToFile_wait_end(void);
+extern void PgAuditLogToFile_wait_reset(void);
+
+#endif
@@ -0,0 +1,3 @@
+# pgauditlogtofile/objs.mk
+# objects of the extension, shared by the Makefile and bench/Makefile
+PGAUDIT_LTF_OBJS = pgauditlogtofile.o logtofile.o logtofile_bgw.o logtofile_connect.o logtofile_guc.o logtofile_log.o logtofile_shmem.o logtofile_vars.o logtofile_filename.o logtofile_json.o logtofile_csv.o logtofile_string_format.o logtofile_execution_memory.o logtofile_execution_time.o logtofile_execution_hook.o logtofile_execution_buffers.o logtofile_execution_jit.o logtofile_execution_rusage.o logtofile_execution_parallel.o logtofile_execution_plan.o logtofile_archive.o logtofile_close_barrier.o logtofile_retention.o logtofile_retired.o logtofile_sequence.o logtofile_signal_handler.o logtofile_errordata.o logtofile_pending.o logtofile_stats.o logtofile_latency.o logtofile_wait_event.o
@@ -0,0 +1,84 @@
+/* pgauditlogtofile/pgauditlogtofile--1.8--1.9.sql */
+
+-- complain if script is sourced in psql, rather than via ALTER EXTENSION
+\echo Use "ALTER EXTENSION pgauditlogtofile UPDATE TO '1.9'" to load this file. \quit
+
+CREATE FUNCTION pgauditlogtofile_stat(
+    OUT pid integer,
+    OUT records bigint,
+    OUT bytes_formatted bigint,
+    OUT bytes_written bigint,
+    OUT compression_ratio double precision,
+    OUT write_failures bigint,
+    OUT reopens bigint
+)
+RETURNS SETOF record
+AS 'MODULE_PATHNAME', 'pgauditlogtofile_stat'
+LANGUAGE C STRICT VOLATILE PARALLEL SAFE;
+
+CREATE VIEW pg_stat_pgauditlogtofile AS
+  SELECT * FROM pgauditlogtofile_stat();
+
+REVOKE ALL ON FUNCTION pgauditlogtofile_stat() FROM PUBLIC;
+REVOKE ALL ON pg_stat_pgauditlogtofile FROM PUBLIC;
+GRANT EXECUTE ON FUNCTION pgauditlogtofile_stat() TO pg_read_all_stats;
+GRANT SELECT ON pg_stat_pgauditlogtofile TO pg_read_all_stats;
+
+CREATE FUNCTION pgauditlogtofile_latency_histogram(
+    OUT stage text,
+    OUT lower_ns bigint,
+    OUT upper_ns bigint,
+    OUT count bigint
+)
+RETURNS SETOF record
+AS 'MODULE_PATHNAME', 'pgauditlogtofile_latency_histogram'
+LANGUAGE C STRICT VOLATILE PARALLEL SAFE;
+
+CREATE FUNCTION pgauditlogtofile_latency_reset()
+RETURNS void
+AS 'MODULE_PATHNAME', 'pgauditlogtofile_latency_reset'
+LANGUAGE C STRICT VOLATILE PARALLEL UNSAFE;
+
+-- percentiles are the upper bound of the bucket, the overflow bucket reports NULL
+CREATE VIEW pg_stat_pgauditlogtofile_latency AS
+  WITH buckets AS (
+    SELECT stage, upper_ns, count,
+           sum(count) OVER (PARTITION BY stage ORDER BY lower_ns) AS cumulative,
+           sum(count) OVER (PARTITION BY stage) AS total
+    FROM pgauditlogtofile_latency_histogram()
+  )
+  SELECT stage,
+         max(total)::bigint AS count,
+         (array_agg(upper_ns ORDER BY cumulative) FILTER (WHERE cumulative >= 0.5 * total))[1] AS p50_ns,
+         (array_agg(upper_ns ORDER BY cumulative) FILTER (WHERE cumulative >= 0.99 * total))[1] AS p99_ns,
+         (array_agg(upper_ns ORDER BY cumulative) FILTER (WHERE cumulative >= 0.999 * total))[1] AS p999_ns
+  FROM buckets
+  GROUP BY stage;
+
+REVOKE ALL ON FUNCTION pgauditlogtofile_latency_histogram() FROM PUBLIC;
+REVOKE ALL ON FUNCTION pgauditlogtofile_latency_reset() FROM PUBLIC;
+REVOKE ALL ON pg_stat_pgauditlogtofile_latency FROM PUBLIC;
+GRANT EXECUTE ON FUNCTION pgauditlogtofile_latency_histogram() TO pg_read_all_stats;
+GRANT SELECT ON pg_stat_pgauditlogtofile_latency TO pg_read_all_stats;
+
+CREATE FUNCTION pgauditlogtofile_archiver_stat(
+    OUT archived_count bigint,
+    OUT last_archived_file text,
+    OUT last_archived_time timestamptz,
+    OUT failed_count bigint,
+    OUT last_failed_file text,
+    OUT last_failed_time timestamptz,
+    OUT pending_count integer,
+    OUT running_count integer
+)
+RETURNS record
+AS 'MODULE_PATHNAME', 'pgauditlogtofile_archiver_stat'
+LANGUAGE C STRICT VOLATILE PARALLEL SAFE;
+
+CREATE VIEW pg_stat_pgauditlogtofile_archiver AS
+  SELECT * FROM pgauditlogtofile_archiver_stat();
+
+REVOKE ALL ON FUNCTION pgauditlogtofile_archiver_stat() FROM PUBLIC;
+REVOKE ALL ON pg_stat_pgauditlogtofile_archiver FROM PUBLIC;
+GRANT EXECUTE ON FUNCTION pgauditlogtofile_archiver_stat() TO pg_read_all_stats;
+GRANT SELECT ON pg_stat_pgauditlogtofile_archiver TO pg_read_all_stats;
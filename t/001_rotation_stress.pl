@@ -0,0 +1,171 @@
+# Copyright (c) 2026, Francisco Miguel Biete Banon
+#
+# Rotation under load: hundreds of clients write audit records while the
+# audit file is rotated by SIGHUP (log_filename change), by time
+# (log_rotation_age_seconds) and by SIGUSR1 (file descriptor closure).
+#
+# Every record must land exactly once and whole, one record per line.
+#
+# Resource intensive, only runs with PG_TEST_EXTRA=pgauditlogtofile_stress.
+#   PGAUDIT_LTF_STRESS_CLIENTS  concurrent clients (default: 200)
+#   PGAUDIT_LTF_STRESS_SECONDS  duration (default: 30)
+#   PGAUDIT_LTF_STRESS_INTERVAL seconds between forced rotations (default: 3)
+
+use strict;
+use warnings FATAL => 'all';
+
+use File::Spec;
+use IPC::Run;
+use JSON::PP;
+use PostgreSQL::Test::Cluster;
+use PostgreSQL::Test::Utils;
+use Test::More;
+use Time::HiRes qw(time usleep);
+
+if (!defined $ENV{PG_TEST_EXTRA}
+	|| $ENV{PG_TEST_EXTRA} !~ /\bpgauditlogtofile_stress\b/)
+{
+	plan skip_all =>
+	  'test pgauditlogtofile_stress not enabled in PG_TEST_EXTRA';
+}
+
+my $clients = $ENV{PGAUDIT_LTF_STRESS_CLIENTS} // 200;
+my $seconds = $ENV{PGAUDIT_LTF_STRESS_SECONDS} // 30;
+my $interval = $ENV{PGAUDIT_LTF_STRESS_INTERVAL} // 3;
+
+my $node = PostgreSQL::Test::Cluster->new('rotation_stress');
+$node->init;
+
+my $pkglibdir = $node->config_data('--pkglibdir');
+if (!-f "$pkglibdir/pgaudit.so")
+{
+	plan skip_all => "pgaudit is not installed in $pkglibdir";
+}
+
+$node->append_conf(
+	'postgresql.conf', qq(
+shared_preload_libraries = 'pgaudit,pgauditlogtofile'
+max_connections = @{[ $clients + 20 ]}
+pgaudit.log = 'read'
+pgaudit.log_directory = 'audit'
+pgaudit.log_filename = 'audit-%Y%m%d_%H%M%S-0.log'
+pgaudit.log_format = 'json'
+pgaudit.log_rotation_age_seconds = '10s'
+));
+$node->start;
+
+$node->safe_psql('postgres', 'CREATE SEQUENCE ltf_mark');
+
+# each transaction audits a statement with a unique mark
+my $script = File::Spec->catfile(PostgreSQL::Test::Utils::tempdir(), 'mark.sql');
+PostgreSQL::Test::Utils::append_to_file(
+	$script, q(SELECT nextval('ltf_mark') AS n \gset
+SELECT 'ltf-mark-:n' AS mark;
+));
+
+my ($stdout, $stderr) = ('', '');
+my $pgbench = IPC::Run::start(
+	[
+		'pgbench', '-n',
+		'-c', $clients,
+		'-j', 8,
+		'-T', $seconds,
+		'-f', $script,
+		$node->connstr('postgres')
+	],
+	'>', \$stdout, '2>', \$stderr);
+
+my $start = time();
+my $rotation = 0;
+my $sighups = 0;
+my $sigusr1s = 0;
+
+my $bgw_pid = $node->safe_psql('postgres',
+	"SELECT pid FROM pg_stat_activity WHERE backend_type = 'pgauditlogtofile launcher'"
+);
+ok($bgw_pid =~ /^\d+$/, 'rotation worker is running');
+
+# alternate forced rotations until pgbench is done
+while ($pgbench->pumpable)
+{
+	usleep($interval * 1_000_000);
+	last if time() - $start >= $seconds;
+
+	$rotation++;
+	if ($rotation % 2)
+	{
+		$node->safe_psql('postgres',
+			"ALTER SYSTEM SET pgaudit.log_filename = 'audit-%Y%m%d_%H%M%S-$rotation.log'"
+		);
+		$node->reload;
+		$sighups++;
+	}
+	else
+	{
+		kill 'USR1', $bgw_pid;
+		$sigusr1s++;
+	}
+}
+$pgbench->finish;
+my $elapsed = time() - $start;
+is($pgbench->result, 0, 'pgbench completed') or diag($stderr);
+
+my ($tps) = $stdout =~ /^tps = ([\d.]+)/m;
+my ($failed) = $stdout =~ /^number of failed transactions: (\d+)/m;
+is($failed // 0, 0, 'no failed transactions');
+
+my $expected = $node->safe_psql('postgres', 'SELECT last_value FROM ltf_mark');
+
+# read every audit file, each line must be a whole record
+my $audit_dir = $node->data_dir . '/audit';
+my $json = JSON::PP->new;
+my %marks;
+my $files = 0;
+my $lines = 0;
+my $broken = 0;
+my $duplicates = 0;
+
+opendir(my $dh, $audit_dir) or die "could not open $audit_dir: $!";
+foreach my $file (sort grep { /^audit-/ } readdir($dh))
+{
+	$files++;
+	open(my $fh, '<', "$audit_dir/$file") or die "could not open $file: $!";
+	while (my $line = <$fh>)
+	{
+		my $record;
+
+		$lines++;
+		chomp $line;
+		$record = eval { $json->decode($line) };
+		if (!defined $record || ref($record) ne 'HASH')
+		{
+			diag("broken record in $file: " . substr($line, 0, 200))
+			  if $broken++ < 10;
+			next;
+		}
+
+		my @found = ($record->{content} // '') =~ /ltf-mark-(\d+)/g;
+		foreach my $mark (@found)
+		{
+			$duplicates++ if $marks{$mark}++;
+		}
+	}
+	close($fh);
+}
+closedir($dh);
+
+diag(sprintf(
+		"%d clients, %.0f s, %d SIGHUP and %d SIGUSR1 rotations, %d files, %d records, %.0f tps, %.0f records/s",
+		$clients, $elapsed, $sighups, $sigusr1s, $files, $lines, $tps // 0,
+		$lines / $elapsed));
+
+# a time rotation every 10 seconds, the first and last ones may fall outside of the run
+cmp_ok($files, '>=', $sighups + int($elapsed / 10) - 1,
+	'every SIGHUP and time rotation created a file');
+is($broken, 0, 'records are never interleaved');
+is($duplicates, 0, 'no record is written twice');
+is(scalar(keys %marks), $expected, 'every record is written');
+
+$node->stop;
+
+done_testing();
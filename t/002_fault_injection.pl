@@ -0,0 +1,169 @@
+# Copyright (c) 2026, Francisco Miguel Biete Banon
+#
+# Slow and failing audit storage: statement latency and record loss with the
+# faults of pgaudit.debug_fault_injection.
+#
+# Only runs when the extension was built with FAULT_INJECTION=1.
+#   PGAUDIT_LTF_FAULT_STATEMENTS  audited statements per case (default: 200)
+
+use strict;
+use warnings FATAL => 'all';
+
+use JSON::PP;
+use PostgreSQL::Test::Cluster;
+use PostgreSQL::Test::Utils;
+use Test::More;
+use Time::HiRes qw(time);
+
+my $statements = $ENV{PGAUDIT_LTF_FAULT_STATEMENTS} // 200;
+
+my $node = PostgreSQL::Test::Cluster->new('fault_injection');
+$node->init;
+
+my $pkglibdir = $node->config_data('--pkglibdir');
+if (!-f "$pkglibdir/pgaudit.so")
+{
+	plan skip_all => "pgaudit is not installed in $pkglibdir";
+}
+
+$node->append_conf(
+	'postgresql.conf', qq(
+shared_preload_libraries = 'pgaudit,pgauditlogtofile'
+pgaudit.log = 'read'
+pgaudit.log_directory = 'audit'
+pgaudit.log_filename = 'audit.log'
+pgaudit.log_format = 'json'
+));
+$node->start;
+
+my ($ret) = $node->psql('postgres', 'SHOW pgaudit.debug_fault_injection');
+if ($ret != 0)
+{
+	$node->stop;
+	plan skip_all => 'pgauditlogtofile was not built with FAULT_INJECTION=1';
+}
+
+$node->safe_psql('postgres', 'CREATE EXTENSION pgauditlogtofile');
+
+my $json = JSON::PP->new;
+
+# marks of the case found in the audit file under test, and whole records that aren't
+sub audit_marks
+{
+	my ($case, $filename) = @_;
+	my %marks;
+	my $broken = 0;
+	my $file = $node->data_dir . "/audit/$filename";
+
+	return (\%marks, 0) if !-f $file;
+
+	open(my $fh, '<', $file) or die "could not open $file: $!";
+	while (my $line = <$fh>)
+	{
+		chomp $line;
+		my $record = eval { $json->decode($line) };
+		if (!defined $record)
+		{
+			$broken++;
+			next;
+		}
+		my $content = $record->{content} // '';
+		$marks{$1}++ while $content =~ /ltf-$case-(\d+)/g;
+	}
+	close($fh);
+
+	return (\%marks, $broken);
+}
+
+# marks of the case written to the server log by the fallback
+sub server_marks
+{
+	my ($case, $offset) = @_;
+	my %marks;
+	my $log = slurp_file($node->logfile, $offset);
+
+	$marks{$1}++ while $log =~ /ltf-$case-(\d+)/g;
+
+	return \%marks;
+}
+
+sub write_failures
+{
+	return $node->safe_psql('postgres',
+		'SELECT write_failures FROM pg_stat_pgauditlogtofile WHERE pid IS NULL');
+}
+
+# runs the audited statements of a case, returns the seconds per statement
+sub run_case
+{
+	my ($case, $faults) = @_;
+	my $sql = "SET pgaudit.debug_fault_injection = '$faults';\n";
+	my $start;
+
+	$sql .= "SELECT 'ltf-$case-$_';\n" for (1 .. $statements);
+
+	$start = time();
+	$node->safe_psql('postgres', $sql);
+
+	return (time() - $start) / $statements;
+}
+
+# checks where the records of a case landed, the audit file is the current pgaudit.log_filename
+sub check_case
+{
+	my ($case, $faults, $filename, $expect_file, $expect_server) = @_;
+	my $offset = -s $node->logfile;
+	my $failures = write_failures();
+	my $latency = run_case($case, $faults);
+	my ($audit, $broken) = audit_marks($case, $filename);
+	my $server = server_marks($case, $offset);
+	my $lost = 0;
+	my $duplicated = 0;
+
+	for my $i (1 .. $statements)
+	{
+		my $count = ($audit->{$i} // 0) + ($server->{$i} // 0);
+
+		$lost++ if $count == 0;
+		$duplicated++ if $count > 1;
+	}
+
+	diag(sprintf(
+			"%-12s %-32s %8.3f ms/statement, %d in file, %d in server log, %d lost, %d write failures",
+			$case, "'$faults'", $latency * 1000,
+			scalar(keys %$audit), scalar(keys %$server), $lost,
+			write_failures() - $failures));
+
+	is($broken, 0, "$case: records in the audit file are whole");
+	is($lost, 0, "$case: no record is lost");
+	is($duplicated, 0, "$case: no record is duplicated");
+	is(scalar(keys %$audit), $statements, "$case: every record is in the audit file")
+	  if $expect_file eq 'all';
+	is(scalar(keys %$audit), 0, "$case: no record is in the audit file")
+	  if $expect_file eq 'none';
+	is(scalar(keys %$server), 0, "$case: no record falls back to the server log")
+	  if $expect_server eq 'none';
+
+	return $latency;
+}
+
+my $baseline = check_case('baseline', '', 'audit.log', 'all', 'none');
+
+my $slow = check_case('slow', 'write_delay=5', 'audit.log', 'all', 'none');
+cmp_ok($slow - $baseline, '>=', 0.004,
+	'write latency of the audit storage is paid by the statement');
+
+check_case('short', 'short_write=1', 'audit.log', 'all', 'none');
+check_case('eio', 'write_eio=1', 'audit.log', 'none', 'all');
+check_case('enospc', 'write_enospc=0.5', 'audit.log', 'some', 'some');
+
+# a new file forces the open, which fails, the worker already created it empty
+$node->safe_psql('postgres', "ALTER SYSTEM SET pgaudit.log_filename = 'audit-open.log'");
+$node->reload;
+$node->poll_query_until('postgres', "SELECT current_setting('pgaudit.log_filename') = 'audit-open.log'");
+check_case('open_eio', 'open_eio=1', 'audit-open.log', 'none', 'all');
+ok(!-s $node->data_dir . '/audit/audit-open.log', 'open_eio: nothing is written to the file');
+
+$node->stop;
+
+done_testing();
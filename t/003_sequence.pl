@@ -0,0 +1,79 @@
+# Copyright (c) 2026, Francisco Miguel Biete Banon
+#
+# Sequence numbers of the audit records: they never repeat across clean
+# restarts and crashes, and pgauditlogtofile_merge --check finds no gap
+# between clean restarts.
+
+use strict;
+use warnings FATAL => 'all';
+
+use IPC::Run;
+use JSON::PP;
+use PostgreSQL::Test::Cluster;
+use PostgreSQL::Test::Utils;
+use Test::More;
+
+my $node = PostgreSQL::Test::Cluster->new('sequence');
+$node->init;
+
+my $pkglibdir = $node->config_data('--pkglibdir');
+if (!-f "$pkglibdir/pgaudit.so")
+{
+	plan skip_all => "pgaudit is not installed in $pkglibdir";
+}
+
+$node->append_conf(
+	'postgresql.conf', qq(
+shared_preload_libraries = 'pgaudit,pgauditlogtofile'
+pgaudit.log = 'read'
+pgaudit.log_directory = 'audit'
+pgaudit.log_filename = 'audit.log'
+pgaudit.log_format = 'json'
+));
+$node->start;
+
+my $file = $node->data_dir . '/audit/audit.log';
+my $json = JSON::PP->new;
+
+# sequence numbers of the records of a mark
+sub sequences
+{
+	my ($mark) = @_;
+	my @sequences;
+
+	open(my $fh, '<', $file) or die "could not open $file: $!";
+	while (my $line = <$fh>)
+	{
+		my $record = $json->decode($line);
+
+		push @sequences, $record->{'custom.sequence'}
+		  if ($record->{content} // '') =~ /ltf-$mark-/;
+	}
+	close($fh);
+
+	return @sequences;
+}
+
+$node->safe_psql('postgres', "SELECT 'ltf-first-$_'") for (1 .. 10);
+my @first = sequences('first');
+is(scalar(@first), 10, 'every record has a sequence number');
+
+$node->restart;
+$node->safe_psql('postgres', "SELECT 'ltf-restart-$_'") for (1 .. 10);
+my @restart = sequences('restart');
+cmp_ok($restart[0], '>', $first[-1], 'the sequence continues after a restart');
+
+my ($stdout, $stderr);
+my $merge = ($ENV{TESTDIR} // '.') . '/tools/pgauditlogtofile_merge';
+my $ok = IPC::Run::run([ $^X, $merge, '--check', $file ], '>', \$stdout, '2>', \$stderr);
+ok($ok, 'no gap after a clean restart') or diag($stderr);
+
+$node->stop('immediate');
+$node->start;
+$node->safe_psql('postgres', "SELECT 'ltf-crash-$_'") for (1 .. 10);
+my @crash = sequences('crash');
+cmp_ok($crash[0], '>', $restart[-1], 'the sequence never goes back after a crash');
+
+$node->stop;
+
+done_testing();
@@ -0,0 +1,2 @@
+-- connection storms (run with -C, one connection per transaction)
+SELECT 1;
@@ -0,0 +1,8 @@
+-- DDL bursts
+BEGIN;
+CREATE TABLE bench_ddl_:client_id (id int PRIMARY KEY, v text);
+CREATE INDEX ON bench_ddl_:client_id (v);
+ALTER TABLE bench_ddl_:client_id ADD COLUMN w int;
+COMMENT ON TABLE bench_ddl_:client_id IS 'pgauditlogtofile bench';
+DROP TABLE bench_ddl_:client_id;
+COMMIT;
@@ -0,0 +1,4 @@
+-- wide INSERTs with big parameters, pgaudit.log_parameter logs them (run with -M prepared)
+\set aid random(1, 100000 * :scale)
+\set len random(1024, 16384)
+INSERT INTO bench_wide (aid, c1, c2, c3, c4) VALUES (:aid, repeat('a', :len), repeat('b', :len), md5(:aid::text), now());
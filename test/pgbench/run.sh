@@ -0,0 +1,187 @@
+#!/usr/bin/env bash
+#
+# pgauditlogtofile pgbench suite
+#
+# Starts a temporary cluster and runs every workload against an un-audited
+# baseline and against every combination of format, compression and execution
+# stats. Results go to $OUTPUT as csv, one row per configuration and workload.
+#
+# Environment:
+#   PG_CONFIG     pg_config of the installation to test (default: pg_config)
+#   PGPORT        port of the temporary cluster (default: 55432)
+#   DURATION      seconds per run (default: 30)
+#   CLIENTS       pgbench clients (default: 8)
+#   JOBS          pgbench threads (default: 2)
+#   SCALE         pgbench scale factor (default: 10)
+#   WORKLOADS     subset of: select insert_wide ddl connect
+#   FORMATS       subset of: csv json
+#   COMPRESSIONS  subset of: off gzip lz4 zstd
+#   STATS         subset of: none time all
+#   OUTPUT        result file (default: pgbench_results.csv)
+#   KEEP_DATA     leave the cluster directory behind when set
+#
+set -euo pipefail
+
+SCRIPT_DIR=$(cd "$(dirname "$0")" && pwd)
+
+PG_CONFIG=${PG_CONFIG:-pg_config}
+PGBIN=$("$PG_CONFIG" --bindir)
+PGPORT=${PGPORT:-55432}
+DURATION=${DURATION:-30}
+CLIENTS=${CLIENTS:-8}
+JOBS=${JOBS:-2}
+SCALE=${SCALE:-10}
+WORKLOADS=${WORKLOADS:-"select insert_wide ddl connect"}
+FORMATS=${FORMATS:-"csv json"}
+COMPRESSIONS=${COMPRESSIONS:-"off gzip lz4 zstd"}
+STATS=${STATS:-"none time all"}
+OUTPUT=${OUTPUT:-pgbench_results.csv}
+
+export PGPORT PGHOST=/tmp PGUSER=postgres PGDATABASE=postgres
+
+DATA_DIR=$(mktemp -d -t pgauditlogtofile_bench.XXXXXX)
+AUDIT_DIR=$DATA_DIR/audit
+PGDATA=$DATA_DIR/data
+
+cleanup() {
+  "$PGBIN/pg_ctl" -D "$PGDATA" -m immediate stop >/dev/null 2>&1 || true
+  if [ -z "${KEEP_DATA:-}" ]; then
+    rm -rf "$DATA_DIR"
+  fi
+}
+trap cleanup EXIT
+
+if [ ! -f "$("$PG_CONFIG" --pkglibdir)/pgaudit.so" ]; then
+  echo "pgaudit is not installed in $("$PG_CONFIG" --pkglibdir)" >&2
+  exit 1
+fi
+
+# $1: shared_preload_libraries, rest: extra -c settings
+start_server() {
+  local libraries=$1
+  local options="-c shared_preload_libraries='$libraries' -c port=$PGPORT -c unix_socket_directories=/tmp -c listen_addresses=''"
+  local setting
+
+  shift
+  for setting in "$@"; do
+    options="$options -c $setting"
+  done
+
+  "$PGBIN/pg_ctl" -D "$PGDATA" -w -l "$DATA_DIR/server.log" -o "$options" start >/dev/null
+}
+
+stop_server() {
+  "$PGBIN/pg_ctl" -D "$PGDATA" -w -m fast stop >/dev/null
+}
+
+# $1: workload, prints "tps,latency_ms,failed"
+run_workload() {
+  local workload=$1
+  local extra=()
+  local out
+
+  case $workload in
+    insert_wide) extra=(-M prepared) ;;
+    connect) extra=(-C) ;;
+  esac
+
+  out=$("$PGBIN/pgbench" -n -c "$CLIENTS" -j "$JOBS" -T "$DURATION" -s "$SCALE" \
+    "${extra[@]}" -f "$SCRIPT_DIR/$workload.sql" pgbench 2>&1) || {
+    echo "$out" >&2
+    return 1
+  }
+
+  echo "$out" | awk '
+    /^tps = / { tps = $3 }
+    /^latency average = / { latency = $4 }
+    /^number of failed transactions: / { failed = $5 }
+    END { printf "%s,%s,%s\n", tps, latency, (failed == "" ? 0 : failed) }'
+}
+
+audit_bytes() {
+  du -sb "$AUDIT_DIR" 2>/dev/null | cut -f1
+}
+
+# $1: stats level, prints the execution GUCs
+stats_settings() {
+  local value=off
+
+  case $1 in
+    none) ;;
+    time) echo "pgaudit.log_execution_time=on" ; return ;;
+    all) value=on ;;
+  esac
+
+  echo "pgaudit.log_execution_time=$value"
+  echo "pgaudit.log_execution_memory=$value"
+  echo "pgaudit.log_execution_buffers=$value"
+  echo "pgaudit.log_execution_jit=$value"
+  echo "pgaudit.log_execution_rusage=$value"
+  echo "pgaudit.log_execution_parallel=$value"
+}
+
+# $1: configuration name, $2: shared_preload_libraries, rest: settings
+run_configuration() {
+  local name=$1
+  local libraries=$2
+  local workload
+  local result
+  local tps
+  local base_tps
+  local bytes_before
+
+  shift 2
+  start_server "$libraries" "$@"
+  for workload in $WORKLOADS; do
+    bytes_before=$(audit_bytes)
+    result=$(run_workload "$workload")
+    tps=${result%%,*}
+
+    if [ "$name" = "baseline" ]; then
+      BASELINE[$workload]=$tps
+    fi
+    base_tps=${BASELINE[$workload]}
+
+    echo "$name,$workload,$result,$(awk -v t="$tps" -v b="$base_tps" 'BEGIN { printf "%.2f", (1 - t / b) * 100 }'),$(( $(audit_bytes) - bytes_before ))" >>"$OUTPUT"
+    echo "$name $workload: $result" >&2
+  done
+  stop_server
+}
+
+declare -A BASELINE
+
+"$PGBIN/initdb" -A trust -U postgres -D "$PGDATA" >/dev/null
+mkdir -p "$AUDIT_DIR"
+
+# schema, loaded without auditing
+start_server ""
+"$PGBIN/createdb" pgbench
+"$PGBIN/pgbench" -i -q -s "$SCALE" pgbench >/dev/null 2>&1
+"$PGBIN/psql" -X -q -v ON_ERROR_STOP=1 -d pgbench \
+  -c "CREATE TABLE bench_wide (aid int, c1 text, c2 text, c3 text, c4 timestamptz)"
+stop_server
+
+echo "configuration,workload,tps,latency_ms,failed,degradation_pct,audit_bytes" >"$OUTPUT"
+
+run_configuration baseline ""
+
+for format in $FORMATS; do
+  for compression in $COMPRESSIONS; do
+    for stats in $STATS; do
+      # shellcheck disable=SC2046
+      run_configuration "$format-$compression-$stats" "pgaudit,pgauditlogtofile" \
+        "pgaudit.log=all" \
+        "pgaudit.log_parameter=on" \
+        "pgaudit.log_connections=on" \
+        "pgaudit.log_disconnections=on" \
+        "log_connections=on" \
+        "log_disconnections=on" \
+        "pgaudit.log_directory=$AUDIT_DIR" \
+        "pgaudit.log_format=$format" \
+        "pgaudit.log_compression=$compression" \
+        $(stats_settings "$stats")
+    done
+  done
+done
+
+echo "results in $OUTPUT" >&2
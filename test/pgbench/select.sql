@@ -0,0 +1,3 @@
+-- short audited SELECTs
+\set aid random(1, 100000 * :scale)
+SELECT abalance FROM pgbench_accounts WHERE aid = :aid;
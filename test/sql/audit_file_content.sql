@@ -14,6 +14,23 @@ SELECT pgauditlogtofile_regression_audit_log_content('REGRESSION_CSV_TEST');
 
 SELECT pgauditlogtofile_regression_server_log_content('REGRESSION_CSV_TEST');
 
+-- The record with a plan is still a valid CSV row, and the plan field reads back as JSON
+ALTER SYSTEM SET pgaudit.log_execution_plan_min_duration = 0;
+
+SELECT pg_reload_conf();
+
+SELECT /* REGRESSION_CSV_PLAN_TEST */ 1;
+
+SELECT line ~ '^("([^"]|"")*"|[^,"]*)(,("([^"]|"")*"|[^,"]*))*$' AS valid_csv,
+       json_typeof(replace(substring(line from ',"((?:[^"]|"")*)","[0-9]+"$'), '""', '"')::json) AS plan
+FROM regexp_split_to_table(pg_read_file(
+       current_setting('data_directory') || '/' ||
+       current_setting('pgaudit.log_directory') || '/' ||
+       'regression-audit-' || TO_CHAR(NOW(), 'YYYYMMDDHH24') || '.log'), E'\n') AS line
+WHERE strpos(line, 'REGRESSION_CSV_PLAN_TEST */ 1"') > 0;
+
+ALTER SYSTEM RESET pgaudit.log_execution_plan_min_duration;
+
 
 
 -- Set audit format to JSON
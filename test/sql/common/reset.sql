@@ -5,6 +5,14 @@ ALTER SYSTEM RESET pgaudit.log_filename;
 ALTER SYSTEM RESET pgaudit.log_file_mode;
 
 ALTER SYSTEM RESET pgaudit.log_rotation_age;
+ALTER SYSTEM RESET pgaudit.log_rotation_age_seconds;
+ALTER SYSTEM RESET pgaudit.log_rotation_nudge_delay;
+ALTER SYSTEM RESET pgaudit.log_rotation_size;
+ALTER SYSTEM RESET pgaudit.log_shards;
+ALTER SYSTEM RESET pgaudit.log_retention_age;
+ALTER SYSTEM RESET pgaudit.log_retention_size;
+ALTER SYSTEM RESET pgaudit.log_archive_command;
+ALTER SYSTEM RESET pgaudit.log_archive_max_parallel;
 
 ALTER SYSTEM RESET pgaudit.log_connections;
 
@@ -17,6 +25,14 @@ ALTER SYSTEM RESET pgaudit.log_format;
 ALTER SYSTEM RESET pgaudit.log_execution_time;
 
 ALTER SYSTEM RESET pgaudit.log_execution_memory;
+ALTER SYSTEM RESET pgaudit.log_execution_memory_sample_interval;
+ALTER SYSTEM RESET pgaudit.log_execution_buffers;
+ALTER SYSTEM RESET pgaudit.log_execution_jit;
+ALTER SYSTEM RESET pgaudit.log_execution_rusage;
+ALTER SYSTEM RESET pgaudit.log_execution_parallel;
+ALTER SYSTEM RESET pgaudit.log_execution_plan_min_duration;
+ALTER SYSTEM RESET pgaudit.log_execution_plan_analyze;
+ALTER SYSTEM RESET pgaudit.log_latency_histograms;
 
 ALTER SYSTEM RESET pgaudit.log_compression;
 
@@ -8,12 +8,28 @@ WHERE name IN (
     'pgaudit.log_filename',
     'pgaudit.log_file_mode',
     'pgaudit.log_rotation_age',
+    'pgaudit.log_rotation_age_seconds',
+    'pgaudit.log_rotation_nudge_delay',
+    'pgaudit.log_rotation_size',
+    'pgaudit.log_shards',
+    'pgaudit.log_retention_age',
+    'pgaudit.log_retention_size',
+    'pgaudit.log_archive_command',
+    'pgaudit.log_archive_max_parallel',
     'pgaudit.log_connections',
     'pgaudit.log_disconnections',
     'pgaudit.log_autoclose_minutes',
     'pgaudit.log_format',
     'pgaudit.log_execution_time',
     'pgaudit.log_execution_memory',
+    'pgaudit.log_execution_memory_sample_interval',
+    'pgaudit.log_execution_buffers',
+    'pgaudit.log_execution_jit',
+    'pgaudit.log_execution_rusage',
+    'pgaudit.log_execution_parallel',
+    'pgaudit.log_execution_plan_min_duration',
+    'pgaudit.log_execution_plan_analyze',
+    'pgaudit.log_latency_histograms',
     'pgaudit.log_compression',
     'pgaudit.log_compression_level'
 )
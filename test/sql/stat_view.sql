@@ -0,0 +1,23 @@
+-- Validates the statistics view
+\i test/sql/common/reset.sql
+\i test/sql/common/setup.sql
+
+
+SELECT /* REGRESSION_STAT_TEST */ 1;
+
+SELECT records > 0 AS records, bytes_written > 0 AS bytes_written, write_failures
+FROM pg_stat_pgauditlogtofile
+WHERE pid = pg_backend_pid();
+
+SELECT count(*)
+FROM pg_stat_pgauditlogtofile
+WHERE pid IS NULL;
+
+SELECT archived_count, failed_count, pending_count, running_count
+FROM pg_stat_pgauditlogtofile_archiver;
+
+
+
+-- Clean up
+\i test/sql/common/reset.sql
+\i test/sql/common/teardown.sql